@@ -0,0 +1,210 @@
+#include "export.h"
+
+#define HOUR_S	3600
+#define DAY_S	86400
+#define WEEK_S	(7 * DAY_S)
+#define EXPORT_BUCKETS	(ROLLUP_HOURS + ROLLUP_DAYS + ROLLUP_WEEKS)
+
+static uint32_t mRecordsPerChunk = 0;
+
+// Session: a snapshot of the rollup, the records in the requested range and how far the phone got
+static Rollup mSnapshot;
+static uint32_t mSnapshotReset = 0;	// Start of the snapshot's current day
+static uint32_t mSnapshotWeek = 0;	// and of its current week
+static uint32_t mFrom = 0;
+static uint32_t mTo = 0;
+static uint8_t mSelected[EXPORT_BUCKETS];
+static uint32_t mSelectedCount = 0;
+static uint32_t mChunks = 0;
+static uint32_t mNextSeq = 0;
+static uint32_t mSentSeq = 0;	// Chunk in the outbox, a resume may have moved mNextSeq meanwhile
+static uint32_t mAckedSeq = 0;
+static uint32_t mRetries = 0;
+static bool mActive = false;
+static bool mInFlight = false;
+
+
+// Outbox size for AppMessage. Capped at EXPORT_OUTBOX_MAX, see export.h.
+uint32_t initExport() {
+	uint32_t outbox = app_message_outbox_size_maximum();
+	if (outbox > EXPORT_OUTBOX_MAX)
+		outbox = EXPORT_OUTBOX_MAX;
+
+	// Dictionary header, the sequence and done integers and the data tuple header
+	mRecordsPerChunk = (outbox - dict_calc_buffer_size(3, sizeof(uint32_t), sizeof(uint32_t), 0)) / sizeof(ExportRecord);
+	return outbox;
+}
+
+
+// Last daily reset at or before the given time
+static uint32_t findReset(uint32_t time, int32_t resetTime) {
+	time_t t = (time_t) time;
+	struct tm* local = localtime(&t);
+	uint32_t reset = time - (local->tm_hour * 3600 + local->tm_min * 60 + local->tm_sec) + resetTime * 60;
+	if (reset > time)
+		reset -= DAY_S;
+	return reset;
+}
+
+
+// Bucket i, oldest first: the hours, then the days, then the weeks
+static void makeRecord(uint32_t i, ExportRecord* record) {
+	if (i < ROLLUP_HOURS) {
+		uint32_t back = ROLLUP_HOURS - 1 - i;
+		uint32_t slot = (mSnapshot.hourSlot + ROLLUP_HOURS - back) % ROLLUP_HOURS;
+		record->start = mSnapshot.hourEnd - (back + 1) * HOUR_S;
+		record->length = HOUR_S;
+		record->steps = mSnapshot.hourSteps[slot];
+		for (uint32_t type = 0; type < ROLLUP_TYPES; type++) {
+			record->minutes[type] = getHourMinutes(&mSnapshot, slot, type);
+		}
+	} else if (i < ROLLUP_HOURS + ROLLUP_DAYS) {
+		uint32_t back = ROLLUP_HOURS + ROLLUP_DAYS - 1 - i;
+		uint32_t slot = (mSnapshot.daySlot + ROLLUP_DAYS - back) % ROLLUP_DAYS;
+		record->start = mSnapshotReset - back * DAY_S;
+		record->length = DAY_S;
+		record->steps = mSnapshot.daySteps[slot];
+		memcpy(record->minutes, mSnapshot.dayMinutes[slot], sizeof(record->minutes));
+	} else {
+		uint32_t back = EXPORT_BUCKETS - 1 - i;
+		uint32_t slot = (mSnapshot.weekSlot + ROLLUP_WEEKS - back) % ROLLUP_WEEKS;
+		record->start = mSnapshotWeek - back * WEEK_S;
+		record->length = WEEK_S;
+		record->steps = mSnapshot.weekSteps[slot];
+		memcpy(record->minutes, mSnapshot.weekMinutes[slot], sizeof(record->minutes));
+	}
+}
+
+
+// Take a snapshot and pick the buckets that overlap [from, to)
+static void startSession(uint32_t from, uint32_t to, int32_t resetTime) {
+	mFrom = from;
+	mTo = to;
+	mSelectedCount = 0;
+
+	if (persist_exists(ROLLUP_KEY)) {
+		persist_read_data(ROLLUP_KEY, &mSnapshot, sizeof(Rollup));
+		// The worker may have saved it before the last reset, so its days count from the reset before it was saved
+		mSnapshotReset = findReset(mSnapshot.hourEnd - HOUR_S, resetTime);
+		// Weeks start on Monday. The local time is only read here, once per session, not per record.
+		time_t dayStart = (time_t) mSnapshotReset;
+		mSnapshotWeek = mSnapshotReset - ((localtime(&dayStart)->tm_wday + 6) % 7) * DAY_S;
+
+		ExportRecord record;
+		for (uint32_t i = 0; i < EXPORT_BUCKETS; i++) {
+			makeRecord(i, &record);
+			if (record.start < to && record.start + record.length > from)
+				mSelected[mSelectedCount++] = i;
+		}
+	}
+
+	// An empty export still has one chunk, to tell the phone it is done
+	mChunks = mSelectedCount == 0 ? 1 : (mSelectedCount + mRecordsPerChunk - 1) / mRecordsPerChunk;
+}
+
+
+static void sendChunk(uint32_t seq) {
+	DictionaryIterator* data;
+	mInFlight = true;
+	mSentSeq = seq;
+	if (app_message_outbox_begin(&data) != APP_MSG_OK) {
+		exportFailed();
+		return;
+	}
+
+	uint32_t first = seq * mRecordsPerChunk;
+	uint32_t count = mSelectedCount > first ? mSelectedCount - first : 0;
+	if (count > mRecordsPerChunk)
+		count = mRecordsPerChunk;
+
+	uint8_t bytes[count * sizeof(ExportRecord) + 1];
+	for (uint32_t i = 0; i < count; i++) {
+		ExportRecord record;
+		makeRecord(mSelected[first + i], &record);
+		memcpy(bytes + i * sizeof(ExportRecord), &record, sizeof(ExportRecord));
+	}
+
+	dict_write_uint32(data, EXPORT_SEQ_KEY, seq);
+	dict_write_data(data, EXPORT_DATA_KEY, bytes, count * sizeof(ExportRecord));
+	if (seq == mChunks - 1)
+		dict_write_uint32(data, EXPORT_DONE_KEY, mChunks);
+	app_message_outbox_send();
+}
+
+
+// Keep up to EXPORT_WINDOW chunks ahead of the phone, one message in flight at a time
+static void pump() {
+	if (!mActive || mInFlight || mNextSeq >= mChunks || mNextSeq - mAckedSeq >= EXPORT_WINDOW)
+		return;
+	sendChunk(mNextSeq);
+}
+
+
+static void retry(void* data) {
+	pump();
+}
+
+
+// Requests start or resume a session, acks move the window
+bool handleExportMessage(DictionaryIterator* received, int32_t resetTime) {
+	Tuple* fromTuple = dict_find(received, EXPORT_FROM_KEY);
+	Tuple* ackTuple = dict_find(received, EXPORT_ACK_KEY);
+
+	if (fromTuple != NULL) {
+		Tuple* toTuple = dict_find(received, EXPORT_TO_KEY);
+		Tuple* seqTuple = dict_find(received, EXPORT_SEQ_KEY);
+		uint32_t from = (uint32_t) fromTuple->value->int32;
+		uint32_t to = toTuple != NULL ? (uint32_t) toTuple->value->int32 : UINT32_MAX;
+		uint32_t seq = seqTuple != NULL ? (uint32_t) seqTuple->value->int32 : 0;
+
+		// Resume only what was snapshotted for the same range, anything else starts over
+		if (seq == 0 || from != mFrom || to != mTo || mChunks == 0 || seq > mChunks) {
+			startSession(from, to, resetTime);
+			seq = 0;
+		}
+		APP_LOG(APP_LOG_LEVEL_INFO, "Export: %d records in %d chunks from chunk %d", (int) mSelectedCount, (int) mChunks, (int) seq);
+		mNextSeq = seq;
+		mAckedSeq = seq;
+		mRetries = 0;
+		mActive = true;
+		pump();
+		return true;
+	} else if (ackTuple != NULL) {
+		uint32_t ack = (uint32_t) ackTuple->value->int32;
+		if (ack > mAckedSeq)
+			mAckedSeq = ack;
+		if (mAckedSeq >= mChunks) {
+			APP_LOG(APP_LOG_LEVEL_INFO, "Export: done");
+			mActive = false;
+		}
+		pump();
+		return true;
+	}
+	return false;
+}
+
+
+void exportSent() {
+	if (!mInFlight)
+		return;
+	mInFlight = false;
+	if (mSentSeq == mNextSeq)
+		mNextSeq++;
+	mRetries = 0;
+	pump();
+}
+
+
+// Retry a few times, then go back to the last ack and wait for the phone to ask again
+void exportFailed() {
+	if (!mInFlight)
+		return;
+	mInFlight = false;
+	if (++mRetries <= EXPORT_RETRIES) {
+		app_timer_register(EXPORT_RETRY_MS, &retry, NULL);
+	} else {
+		APP_LOG(APP_LOG_LEVEL_INFO, "Export: paused at chunk %d", (int) mAckedSeq);
+		mNextSeq = mAckedSeq;
+		mActive = false;
+	}
+}
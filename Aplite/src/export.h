@@ -0,0 +1,38 @@
+#ifndef _EXPORT_H_
+#define _EXPORT_H_
+
+#include <pebble.h>
+#include "utility.h"
+
+// AppMessage keys, clear of the watchface's own
+enum {
+	EXPORT_FROM_KEY = 20,	// Phone: start of the requested range, seconds
+	EXPORT_TO_KEY = 21,	// Phone: end of the requested range, seconds
+	EXPORT_SEQ_KEY = 22,	// Phone: chunk to resume from. Watch: sequence number of this chunk
+	EXPORT_DATA_KEY = 23,	// Watch: packed records
+	EXPORT_ACK_KEY = 24,	// Phone: next chunk it expects, acknowledges everything before
+	EXPORT_DONE_KEY = 25	// Watch: on the last chunk, the number of chunks
+};
+
+// The outbox comes out of the app's heap, and app_message_outbox_size_maximum() is 656 bytes on Aplite but
+// about 8 KB on Basalt. 512 bytes hold 24 records a chunk, so all 35 buckets of the rollup go in 2 chunks;
+// the whole 8 KB would save one round trip per export for 7.5 KB of heap held while the watchface runs.
+#define EXPORT_OUTBOX_MAX	512	// Bytes
+#define EXPORT_WINDOW		4	// Chunks sent ahead of the last ack
+#define EXPORT_RETRIES		3	// Attempts per chunk before waiting for the phone to resume
+#define EXPORT_RETRY_MS		500
+
+// One bucket of the rollup, 20 bytes little endian as it goes out
+typedef struct {
+	uint32_t start;	// Seconds
+	uint32_t length;	// 3600, 86400 or 604800
+	uint32_t steps;
+	uint16_t minutes[ROLLUP_TYPES];	// Sleep, sit, walk, jog
+} ExportRecord;
+
+uint32_t initExport();
+bool handleExportMessage(DictionaryIterator* received, int32_t resetTime);
+void exportSent();
+void exportFailed();
+
+#endif
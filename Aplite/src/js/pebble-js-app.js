@@ -1,4 +1,16 @@
-var mPosition = null;
+// Location sampling policy
+var FIX_RING_SIZE = 4;	// Number of recent fixes used to estimate speed
+var FIX_WINDOW_MS = 12 * 60000;	// Fixes older than this, relative to the newest, say nothing about the current speed
+var FIX_MAX_AGE_MS = 60000;	// Reuse any fix younger than this
+var COARSE_ACCURACY_M = 100;	// Coarse fixes worse than this get a high accuracy retry
+var REST_SPEED = 1.0;	// m/s, below this we consider the user at rest
+var BACKOFF_BASE_MS = 5 * 60000;	// Watch asks every 5 minutes
+var BACKOFF_MAX_LEVEL = 3;	// 5, 10, 20, 40 minutes
+
+var mFixes = [];
+var mSpeed = 0;
+var mBackoffLevel = 0;
+var mNextSampleTime = 0;
 
 function calculateDistance(lat1, lon1, lat2, lon2) {
 	var R = 6371000; // meter
@@ -12,8 +24,171 @@ function calculateDistance(lat1, lon1, lat2, lon2) {
 	return d;
 }
 
+function addFix(position) {
+	var last = mFixes.length > 0 ? mFixes[mFixes.length - 1] : null;
+	if (last != null && last.timestamp == position.timestamp) {
+		return;	// Same cached fix
+	}
+	mFixes.push(position);
+	while (mFixes.length > FIX_RING_SIZE || mFixes[0].timestamp < position.timestamp - FIX_WINDOW_MS) {
+		mFixes.shift();
+	}
+}
+
+// Average speed over the ring: path length / time span, null until the ring has two fixes
+function estimateSpeed() {
+	if (mFixes.length < 2) {
+		return null;
+	}
+
+	var distance = 0;
+	for (var i = 1; i < mFixes.length; i++) {
+		distance += calculateDistance(mFixes[i - 1].coords.latitude, mFixes[i - 1].coords.longitude,
+									mFixes[i].coords.latitude, mFixes[i].coords.longitude);
+	}
+	var duration = mFixes[mFixes.length - 1].timestamp - mFixes[0].timestamp;
+	if (duration <= 0) {
+		return null;
+	}
+	console.log("Distance: " + distance + " in " + duration + " ms over " + mFixes.length + " fixes");
+	return distance / duration * 1000;	// m/s
+}
+
+function sendSpeed(speed) {
+	Pebble.sendAppMessage(
+		{ "speed": Math.round(speed * 100) },
+		function(e) {
+			console.log("Successfully delivered message with transactionId=" + e.data.transactionId);
+		},
+		function(e) {
+			console.log("Unable to deliver message with transactionId=" + e.data.transactionId);
+		}
+	);
+}
+
+// Coarse (cell/Wi-Fi) fix first, high accuracy GPS only if the coarse one is not good enough
+function requestPosition(callback) {
+	var coarseOptions = {
+		enableHighAccuracy: false,
+		timeout: 10000,
+		maximumAge: FIX_MAX_AGE_MS
+	};
+	var fineOptions = {
+		enableHighAccuracy: true,
+		timeout: 10000,
+		maximumAge: FIX_MAX_AGE_MS
+	};
+
+	navigator.geolocation.getCurrentPosition(
+		function(position) {
+			if (position.coords.accuracy <= COARSE_ACCURACY_M) {
+				callback(position);
+			} else {
+				navigator.geolocation.getCurrentPosition(
+					callback,
+					function(error) {
+						console.log("Location ERROR: " + error.message);
+						callback(position);	// Better than nothing
+					},
+					fineOptions
+				);
+			}
+		},
+		function(error) {
+			console.log("Location ERROR: " + error.message);
+			navigator.geolocation.getCurrentPosition(
+				callback,
+				function(error) {
+					console.log("Location ERROR: " + error.message);
+				},
+				fineOptions
+			);
+		},
+		coarseOptions
+	);
+}
+
+// History export: the watch sends its rollup in chunks, we ack in order and resume on stalls
+var EXPORT_RECORD_SIZE = 20;	// start, length, steps, 4 x minutes, little endian
+var EXPORT_DAYS = 7;	// Pulled on every start
+var EXPORT_STALL_MS = 10000;	// Ask again from the next expected chunk after this long without data
+
+var mExport = null;
+
+function readUint(bytes, offset, size) {
+	var value = 0;
+	for (var i = size - 1; i >= 0; i--) {
+		value = value * 256 + bytes[offset + i];
+	}
+	return value;
+}
+
+function sendExportMessage(message) {
+	Pebble.sendAppMessage(
+		message,
+		function(e) {},
+		function(e) {
+			console.log("Unable to deliver export message with transactionId=" + e.data.transactionId);
+		}
+	);
+}
+
+function armExportTimer() {
+	clearTimeout(mExport.timer);
+	mExport.timer = setTimeout(function() {
+		if (mExport == null) {
+			return;
+		}
+		console.log("Export stalled, resuming from chunk " + mExport.nextSeq);
+		requestHistory(mExport.from, mExport.to, mExport.nextSeq);
+	}, EXPORT_STALL_MS);
+}
+
+// Seconds since the epoch, [from, to)
+function requestHistory(from, to, seq) {
+	if (mExport == null || mExport.from != from || mExport.to != to || seq == 0) {
+		mExport = { from: from, to: to, nextSeq: 0, records: [], timer: null };
+	}
+	sendExportMessage({ "exportFrom": from, "exportTo": to, "exportSeq": mExport.nextSeq });
+	armExportTimer();
+}
+
+function handleExportChunk(payload) {
+	if (mExport == null) {
+		return;
+	}
+
+	// Out of order chunks are dropped, the ack tells the watch where to go on
+	if (payload.exportSeq == mExport.nextSeq) {
+		var bytes = payload.exportData || [];
+		for (var offset = 0; offset + EXPORT_RECORD_SIZE <= bytes.length; offset += EXPORT_RECORD_SIZE) {
+			mExport.records.push({
+				start: readUint(bytes, offset, 4),
+				length: readUint(bytes, offset + 4, 4),
+				steps: readUint(bytes, offset + 8, 4),
+				minutes: [readUint(bytes, offset + 12, 2), readUint(bytes, offset + 14, 2),
+						readUint(bytes, offset + 16, 2), readUint(bytes, offset + 18, 2)]
+			});
+		}
+		mExport.nextSeq++;
+	}
+	sendExportMessage({ "exportAck": mExport.nextSeq });
+
+	if (payload.exportDone !== undefined && mExport.nextSeq == payload.exportDone) {
+		clearTimeout(mExport.timer);
+		console.log("Export done: " + mExport.records.length + " records");
+		localStorage.setItem("history", JSON.stringify(mExport.records));
+		mExport = null;
+	} else {
+		armExportTimer();
+	}
+}
+
 Pebble.addEventListener("ready", function(e) {
 	console.log("On11 watchface is ready! " + e.ready);
+
+	var now = Math.floor(Date.now() / 1000);
+	requestHistory(now - EXPORT_DAYS * 86400, now, 0);
 });
 
 Pebble.addEventListener("showConfiguration", function() {
@@ -30,43 +205,46 @@ Pebble.addEventListener("webviewclosed", function(e) {
 });
 
 Pebble.addEventListener("appmessage", function(e) {
-	console.log("Received message: " + e.payload);
+	console.log("Received message: " + JSON.stringify(e.payload));
 
-	var options = {
-		enableHighAccuracy: true,
-		timeout: 10000,
-		maximumAge: 0
-	};
+	if (e.payload.exportSeq !== undefined) {
+		handleExportChunk(e.payload);
+		return;
+	}
 
-	navigator.geolocation.getCurrentPosition(
-		function(position) {
-			var speed = 0;
-
-			if (mPosition != null) {
-				var distance = calculateDistance(mPosition.coords.latitude, mPosition.coords.longitude,
-												position.coords.latitude, position.coords.longitude);
-				speed = distance / (position.timestamp - mPosition.timestamp) * 1000;	// m/s
-				console.log("(" + mPosition.coords.latitude + ", " + mPosition.coords.longitude + ") to (" + position.coords.latitude + ", " + position.coords.longitude + ")");
-				console.log("Distance: " + distance);
-				console.log("Current speed: " + speed);
-			}
+	// The watch sends its current activity type along with the request
+	var activityType = e.payload.requestSpeed;
+	var now = Date.now();
+	var isResting = (activityType == 0 || activityType == 1) && mSpeed < REST_SPEED;
 
-			Pebble.sendAppMessage(
-				{ "speed": Math.round(speed * 100) },
-				function(e) {
-					console.log("Successfully delivered message with transactionId=" + e.data.transactionId);
-				},
-				function(e) {
-					console.log("Unable to deliver message with transactionId=" + e.data.transactionId);
-				}
-			);
+	if (!isResting) {
+		mBackoffLevel = 0;
+		mNextSampleTime = 0;
+	} else if (now < mNextSampleTime) {
+		// Sleeping or sitting still: answer from the last estimate without waking up the GPS
+		console.log("Backing off until " + new Date(mNextSampleTime));
+		sendSpeed(mSpeed);
+		return;
+	}
 
-			// Update
-			mPosition = position;
-		},
-		function(error) {
-			console.log("Location ERROR: " + error.message);
-		},
-		options
-	);
+	requestPosition(function(position) {
+		console.log("(" + position.coords.latitude + ", " + position.coords.longitude + ") +/- " + position.coords.accuracy + " m");
+		addFix(position);
+		var speed = estimateSpeed();
+		if (speed == null) {
+			// First fix after a long gap: trust the receiver's own speed if it has one, and sample again on the
+			// next request so that the estimate does not wait for the whole backoff
+			speed = position.coords.speed > 0 ? position.coords.speed : 0;
+			mNextSampleTime = 0;
+		} else if (isResting && speed < REST_SPEED) {
+			mNextSampleTime = Date.now() + BACKOFF_BASE_MS * Math.pow(2, mBackoffLevel);
+			if (mBackoffLevel < BACKOFF_MAX_LEVEL) {
+				mBackoffLevel++;
+			}
+		}
+		mSpeed = speed;
+		console.log("Current speed: " + mSpeed);
+
+		sendSpeed(mSpeed);
+	});
 });
@@ -1,5 +1,6 @@
 #include <pebble.h>
 #include "utility.h"
+#include "export.h"
 
 // AppMessage
 enum {
@@ -30,11 +31,22 @@ static TextLayer* mDateLayer = NULL;
 #ifndef PBL_COLOR
 static InverterLayer* mInverterLayer = NULL;
 #endif
-static GBitmap* mCarBitmap = NULL;
-static GBitmap* mStepBitmap = NULL;
-static GBitmap* mSitBitmap = NULL;
-static GBitmap* mWalkBitmap = NULL;
-static GBitmap* mJogBitmap = NULL;
+
+// Icon atlas: titles stacked in the left 72 columns, the car in the top right corner
+#define TITLE_ICON_WIDTH	72
+#define TITLE_ICON_HEIGHT	18
+#define CAR_ICON_WIDTH	24
+#define CAR_ICON_HEIGHT	26
+enum {
+	STEP_ICON = 0,
+	SIT_ICON,
+	WALK_ICON,
+	JOG_ICON,
+	CAR_ICON,
+	ICONS
+};
+static GBitmap* mAtlasBitmap = NULL;	// Loaded on first use
+static GBitmap* mIcons[ICONS];	// Views into the atlas, NULL when not shown
 static int16_t mStateHeight = 26;
 static int16_t mTitleHeight = 18;
 static int16_t mCounterHeight = 24;
@@ -42,11 +54,20 @@ static int16_t mCounterHeight = 24;
 static Counter mCounter;
 static uint32_t mCurrentType = 0;
 
+// Traffic, logged and cleared every hour
+static uint32_t mWorkerMessages = 0;
+static uint32_t mWorkerBytes = 0;
+static uint32_t mAppMessages = 0;
+static uint32_t mAppBytes = 0;
+static uint32_t mRedraws = 0;
+static uint32_t mHeapHighWater = 0;	// Most heap bytes seen in use, never cleared
+
 
 static void requestSpeed() {
 	DictionaryIterator* data;
 	app_message_outbox_begin(&data);
-	Tuplet value = TupletInteger(REQUEST_SPEED_KEY, 0);
+	// Let the phone know the current activity, so it can back off while the user is at rest
+	Tuplet value = TupletInteger(REQUEST_SPEED_KEY, (int) mCurrentType);
 	dict_write_tuplet(data, &value);
 	app_message_outbox_send();
 }
@@ -114,8 +135,72 @@ static void updateBattery(BatteryChargeState state) {
 }
 
 
+static void sampleHeap() {
+	uint32_t used = heap_bytes_used();
+	if (used > mHeapHighWater) {
+		mHeapHighWater = used;
+	}
+}
+
+
+static void logTraffic() {
+	APP_LOG(APP_LOG_LEVEL_INFO, "Last hour: %lu worker messages (%lu bytes), %lu app messages (%lu bytes), %lu redraws, heap high-water %lu bytes",
+		mWorkerMessages, mWorkerBytes, mAppMessages, mAppBytes, mRedraws, mHeapHighWater);
+	mWorkerMessages = 0;
+	mWorkerBytes = 0;
+	mAppMessages = 0;
+	mAppBytes = 0;
+	mRedraws = 0;
+}
+
+
+static GRect iconRect(uint32_t icon) {
+	if (icon == CAR_ICON) {
+		return GRect(TITLE_ICON_WIDTH, 0, CAR_ICON_WIDTH, CAR_ICON_HEIGHT);
+	}
+	return GRect(0, icon * TITLE_ICON_HEIGHT, TITLE_ICON_WIDTH, TITLE_ICON_HEIGHT);
+}
+
+
+static GBitmap* getIcon(uint32_t icon) {
+	if (mAtlasBitmap == NULL) {
+		size_t used = heap_bytes_used();
+		mAtlasBitmap = gbitmap_create_with_resource(RESOURCE_ID_ATLAS);
+		APP_LOG(APP_LOG_LEVEL_DEBUG, "Icon atlas: %d bytes", (int) (heap_bytes_used() - used));
+	}
+	if (mIcons[icon] == NULL) {
+		mIcons[icon] = gbitmap_create_as_sub_bitmap(mAtlasBitmap, iconRect(icon));
+	}
+	return mIcons[icon];
+}
+
+
+static void evictIcon(uint32_t icon) {
+	if (mIcons[icon] != NULL) {
+		gbitmap_destroy(mIcons[icon]);
+		mIcons[icon] = NULL;
+	}
+}
+
+
+// The car is the only icon that comes and goes, so only its view is evicted
+static void showCar(bool shown) {
+	if (shown) {
+		bitmap_layer_set_bitmap(mDrivingLayer, getIcon(CAR_ICON));
+	} else {
+		bitmap_layer_set_bitmap(mDrivingLayer, NULL);
+		evictIcon(CAR_ICON);
+	}
+	layer_set_hidden(bitmap_layer_get_layer(mDrivingLayer), !shown);
+}
+
+
 // Render clock
 static void updateClock(struct tm* tickTime, TimeUnits unitsChanged) {
+	if (tickTime->tm_min == 0) {
+		logTraffic();
+	}
+
 	static char timeString[] = "00:00";
 	static char dateString[] = "Fri 13";
 	
@@ -146,7 +231,7 @@ static void updateClock(struct tm* tickTime, TimeUnits unitsChanged) {
 	// Check speed
 	if (tickTime->tm_min % 5 == 0 && mSpeedThreshold != 0) {	// Check only if time is XX:05, XX:10, XX:15, etc
 		mIsDriving = false;
-		layer_set_hidden(bitmap_layer_get_layer(mDrivingLayer), !mIsDriving);
+		showCar(mIsDriving);
 		requestSpeed();
 	}
 }
@@ -154,6 +239,8 @@ static void updateClock(struct tm* tickTime, TimeUnits unitsChanged) {
 
 // Render dashboard
 static void updateDashboard(Layer* layer, GContext* context) {
+	mRedraws++;
+
 #ifndef PBL_COLOR
 	graphics_context_set_text_color(context, GColorWhite);
 	graphics_context_set_fill_color(context, GColorBlack);
@@ -174,16 +261,16 @@ static void updateDashboard(Layer* layer, GContext* context) {
 	GRect titleRect;
 	// Steps
 	titleRect = GRect(0, 0, w, mTitleHeight);
-	graphics_draw_bitmap_in_rect(context, mStepBitmap, titleRect);
+	graphics_draw_bitmap_in_rect(context, getIcon(STEP_ICON), titleRect);
 	// Sit
 	titleRect = GRect(w, 0, w, mTitleHeight);
-	graphics_draw_bitmap_in_rect(context, mSitBitmap, titleRect);
+	graphics_draw_bitmap_in_rect(context, getIcon(SIT_ICON), titleRect);
 	// Walk
 	titleRect = GRect(0, bounds.size.h - mTitleHeight, w, mTitleHeight);
-	graphics_draw_bitmap_in_rect(context, mWalkBitmap, titleRect);
+	graphics_draw_bitmap_in_rect(context, getIcon(WALK_ICON), titleRect);
 	// Jog
 	titleRect = GRect(w, bounds.size.h - mTitleHeight, w, mTitleHeight);
-	graphics_draw_bitmap_in_rect(context, mJogBitmap, titleRect);
+	graphics_draw_bitmap_in_rect(context, getIcon(JOG_ICON), titleRect);
 
 
 	/*
@@ -201,6 +288,7 @@ static void updateDashboard(Layer* layer, GContext* context) {
 			// Do NOTHING
 			break;
 		case 1:
+		case 4:	// Driving is shown as sitting
 #ifndef PBL_COLOR
 			graphics_context_set_fill_color(context, GColorWhite);
 #else
@@ -279,7 +367,7 @@ static void updateDashboard(Layer* layer, GContext* context) {
 	 * Time counters
 	 */
 	// Draw the un-selected ones
-	if (mCurrentType != 1) {
+	if (mCurrentType != 1 && mCurrentType != 4) {
 		counterRect = GRect(w, mTitleHeight, w, mCounterHeight);
 		snprintf(tmpStr, 64, "%02d:%02d", (int) (mCounter.sitTime / 3600 % 24), (int) (mCounter.sitTime / 60 % 60));
 		graphics_draw_text(
@@ -332,6 +420,7 @@ static void updateDashboard(Layer* layer, GContext* context) {
 			// Do NOTHING
 			break;
 		case 1:
+		case 4:
 			counterRect = GRect(w, mTitleHeight, w, mCounterHeight);
 			snprintf(tmpStr, 64, "%02d:%02d", (int) (mCounter.sitTime / 3600 % 24), (int) (mCounter.sitTime / 60 % 60));
 			graphics_draw_text(
@@ -393,6 +482,13 @@ static void processBluetoothConnectionEvent(bool connected) {
 // App Message Sync
 static void messageReceived(DictionaryIterator* received, void* context) {
 	APP_LOG(APP_LOG_LEVEL_INFO, "App Message: Received");
+	mAppMessages++;
+	mAppBytes += dict_size(received);
+	sampleHeap();
+
+	// History export requests and acks
+	if (handleExportMessage(received, mResetTime))
+		return;
 
 	if (dict_size(received) == 56) {
 		Tuple* colorTuple = dict_find(received, COLOR_THEME_KEY);
@@ -429,10 +525,10 @@ static void messageReceived(DictionaryIterator* received, void* context) {
 #ifndef PBL_COLOR
 		if (speed >= mSpeedThreshold) {
 			mIsDriving = true;
-			layer_set_hidden(bitmap_layer_get_layer(mDrivingLayer), !mIsDriving);
+			showCar(mIsDriving);
 		} else {
 			mIsDriving = false;
-			layer_set_hidden(bitmap_layer_get_layer(mDrivingLayer), !mIsDriving);
+			showCar(mIsDriving);
 		}
 #endif
 		APP_LOG(APP_LOG_LEVEL_INFO, "Speed: %d (threshold: %d)", speed, (int) mSpeedThreshold);
@@ -452,15 +548,20 @@ static void messageDropped(AppMessageResult reason, void* context) {
 
 static void messageSent(DictionaryIterator* sent, void* context) {
 	APP_LOG(APP_LOG_LEVEL_INFO, "App Message: Sent");
+	exportSent();
 }
 
 
 static void messageFailed(DictionaryIterator* sent, AppMessageResult reason, void* context) {
 	APP_LOG(APP_LOG_LEVEL_INFO, "App Message: Failed");
+	exportFailed();
 }
 
 
 static void workerMessageReceived(uint16_t type, AppWorkerMessage *data) {
+	mWorkerMessages++;
+	mWorkerBytes += sizeof(uint16_t) + sizeof(AppWorkerMessage);
+
 	switch (type) {
 		case 0:
 			mCounter.sleepTime = (uint32_t) data->data0;
@@ -479,8 +580,13 @@ static void workerMessageReceived(uint16_t type, AppWorkerMessage *data) {
 			break;
 		case 5:
 			mCurrentType = (uint32_t) data->data0;
+			// Show the car either when the phone or the worker says so
+			showCar(mIsDriving || mCurrentType == 4);
 			layer_mark_dirty(mDashboardLayer);
 			break;
+		case 110:	// Worker profiler report
+			APP_LOG(APP_LOG_LEVEL_INFO, "Worker profiler %d: %lu", data->data0, ((uint32_t) data->data2 << 16) | data->data1);
+			break;
 		default:
 			break;
 	}
@@ -488,6 +594,11 @@ static void workerMessageReceived(uint16_t type, AppWorkerMessage *data) {
 
 
 static void windowLoad(Window *window) {
+	time_t seconds;
+	uint16_t milliseconds;
+	time_ms(&seconds, &milliseconds);
+	uint32_t start = (uint32_t) seconds * 1000 + milliseconds;
+
 	// Setup UIs
 	Layer* windowLayer = window_get_root_layer(mWindow);
 	GRect bounds = layer_get_bounds(windowLayer);
@@ -517,12 +628,6 @@ static void windowLoad(Window *window) {
 	text_layer_set_text_alignment(mBatteryLayer, GTextAlignmentCenter);
 	text_layer_set_font(mDateLayer, fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD));
 	text_layer_set_text_alignment(mDateLayer, GTextAlignmentCenter);
-	mCarBitmap = gbitmap_create_with_resource(RESOURCE_ID_CAR);
-	mStepBitmap = gbitmap_create_with_resource(RESOURCE_ID_STEP);
-	mSitBitmap = gbitmap_create_with_resource(RESOURCE_ID_SIT);
-	mWalkBitmap = gbitmap_create_with_resource(RESOURCE_ID_WALK);
-	mJogBitmap = gbitmap_create_with_resource(RESOURCE_ID_JOG);
-	bitmap_layer_set_bitmap(mDrivingLayer, mCarBitmap);
 	bitmap_layer_set_alignment(mDrivingLayer, GAlignCenter);
 
 	// Add to window layer
@@ -531,7 +636,7 @@ static void windowLoad(Window *window) {
 	layer_add_child(windowLayer, text_layer_get_layer(mBatteryLayer));
 	layer_add_child(windowLayer, text_layer_get_layer(mDateLayer));
 	layer_add_child(windowLayer, bitmap_layer_get_layer(mDrivingLayer));
-	layer_set_hidden(bitmap_layer_get_layer(mDrivingLayer), !mIsDriving);
+	showCar(mIsDriving);
 #ifndef PBL_COLOR
 	layer_add_child(windowLayer, inverter_layer_get_layer(mInverterLayer));
 #endif
@@ -544,6 +649,10 @@ static void windowLoad(Window *window) {
 #ifndef PBL_COLOR
 	layer_set_hidden(inverter_layer_get_layer(mInverterLayer), mColorTheme);
 #endif
+
+	time_ms(&seconds, &milliseconds);
+	APP_LOG(APP_LOG_LEVEL_DEBUG, "Window load: %d ms", (int) ((uint32_t) seconds * 1000 + milliseconds - start));
+	sampleHeap();
 }
 
 
@@ -551,11 +660,13 @@ static void windowUnload(Window *window) {
 	// Destroy UIs
 	layer_destroy(mDashboardLayer);
 
-	gbitmap_destroy(mCarBitmap);
-	gbitmap_destroy(mStepBitmap);
-	gbitmap_destroy(mSitBitmap);
-	gbitmap_destroy(mWalkBitmap);
-	gbitmap_destroy(mJogBitmap);
+	for (uint32_t i = 0; i < ICONS; i++) {
+		evictIcon(i);
+	}
+	if (mAtlasBitmap != NULL) {
+		gbitmap_destroy(mAtlasBitmap);
+		mAtlasBitmap = NULL;
+	}
 	text_layer_destroy(mClockLayer);
 	text_layer_destroy(mBatteryLayer);
 	text_layer_destroy(mDateLayer);
@@ -577,7 +688,9 @@ static void init(void) {
 	app_message_register_outbox_sent(&messageSent);
 	app_message_register_outbox_failed(&messageFailed);
 	// https://developer.getpebble.com/2/api-reference/group___dictionary.html#ga0551d069624fb5bfc066fecfa4153bde
-	app_message_open(56, 12);
+	// The inbox fits the biggest message the phone sends, the settings with five integers; export requests have
+	// three and acks one. The outbox is sized for history export chunks.
+	app_message_open(dict_calc_buffer_size(5, sizeof(int32_t), sizeof(int32_t), sizeof(int32_t), sizeof(int32_t), sizeof(int32_t)), initExport());
 
 	// AppWorkerMessage
 	app_worker_message_subscribe(&workerMessageReceived);
@@ -0,0 +1,143 @@
+#include "actigraphy.h"
+#include "lowpassfilter.h"
+#include "trace.h"
+
+// Cole-Kripke one-minute weights, newest epoch first; the two future epochs are left out
+static const uint16_t WEIGHTS[SLEEP_SCORE_EPOCHS] = { 230, 76, 58, 54, 106 };
+
+
+static void startSleep(Actigraphy* actigraphy) {
+	memset(actigraphy, 0, sizeof(Actigraphy));
+	actigraphy->active = true;
+}
+
+
+// Feed every classified window; switches to night mode after enough sleep in a row
+void noteActivity(Actigraphy* actigraphy, uint32_t type) {
+	if (type == 0) {
+		actigraphy->sleepWindows++;
+		if (actigraphy->sleepWindows >= SLEEP_ENTRY_WINDOWS) {
+			startSleep(actigraphy);
+			LOG(APP_LOG_LEVEL_INFO, "Night mode: on");
+		}
+	} else {
+		actigraphy->sleepWindows = 0;
+	}
+}
+
+
+bool isSleeping(Actigraphy* actigraphy) {
+	return actigraphy->active;
+}
+
+
+static bool scoreEpoch(Actigraphy* actigraphy) {
+	for (uint32_t i = SLEEP_SCORE_EPOCHS - 1; i > 0; i--) {
+		actigraphy->epochs[i] = actigraphy->epochs[i - 1];
+	}
+	uint32_t scaled = actigraphy->count / SLEEP_COUNT_SCALE;
+	actigraphy->epochs[0] = scaled > UINT16_MAX ? UINT16_MAX : scaled;
+
+	uint32_t score = 0;
+	for (uint32_t i = 0; i < SLEEP_SCORE_EPOCHS; i++) {
+		score += WEIGHTS[i] * actigraphy->epochs[i];
+	}
+	return score >= SLEEP_WAKE_SCORE;
+}
+
+
+void initSleepLog(SleepLog* log) {
+	memset(log, 0, sizeof(SleepLog));
+}
+
+
+static void closeNight(SleepLog* log) {
+	log->nightSlot = (log->nightSlot + 1) % SLEEP_LOG_NIGHTS;
+	log->nights[log->nightSlot] = log->night;
+	memset(&log->night, 0, sizeof(SleepNight));
+	memset(log->wake, 0, sizeof(log->wake));
+	log->bout = 0;
+}
+
+
+static void markEpoch(SleepLog* log, bool awake) {
+	SleepNight* night = &log->night;
+	if (awake) {
+		if (night->epochs < SLEEP_LOG_EPOCHS)
+			log->wake[night->epochs / 8] |= 1 << (night->epochs % 8);
+		night->wakeEpochs++;
+		if (log->bout == 0)
+			night->wakeBouts++;
+		if (log->bout < UINT8_MAX)
+			log->bout++;
+		if (log->bout > night->longestBout)
+			night->longestBout = log->bout;
+	} else {
+		log->bout = 0;
+	}
+	if (night->epochs < UINT16_MAX)
+		night->epochs++;
+}
+
+
+// Record a scored epoch ending at timestamp. A long gap since the last one starts a new night, a short one
+// was spent awake enough to leave night mode and counts as wake.
+void logEpoch(SleepLog* log, uint32_t timestamp, bool awake) {
+	if (log->night.epochs > 0 && (timestamp < log->last || timestamp - log->last > SLEEP_NIGHT_GAP_S))
+		closeNight(log);
+	if (log->night.epochs == 0) {
+		log->night.start = timestamp - SLEEP_EPOCH_S;
+		log->last = log->night.start;
+	}
+
+	for (uint32_t missed = (timestamp - log->last + SLEEP_EPOCH_S / 2) / SLEEP_EPOCH_S; missed > 1; missed--) {
+		markEpoch(log, true);
+	}
+	markEpoch(log, awake);
+	log->last = timestamp;
+}
+
+
+// Returns 0 when an epoch was closed, 1 when night mode ended, 2 while still collecting
+uint32_t trackSleep(Actigraphy* actigraphy, SleepLog* log, Counter* counter, uint32_t timestamp, AccelData* acceleration, uint32_t size) {
+	for (uint32_t i = 0; i < size; i++) {
+		int32_t magnitude = (int32_t) norm(acceleration[i].x, acceleration[i].y, acceleration[i].z);
+		if (actigraphy->samples == 0 && actigraphy->baseline == 0)
+			actigraphy->baseline = magnitude;
+		actigraphy->count += abs(magnitude - actigraphy->baseline);
+		actigraphy->baseline += (magnitude - actigraphy->baseline) / 16;
+		actigraphy->samples++;
+	}
+
+	// Big movement: the user got up
+	if (actigraphy->count >= SLEEP_EXIT_COUNT) {
+		actigraphy->active = false;
+		LOG(APP_LOG_LEVEL_INFO, "Night mode: off (%d)", (int) actigraphy->count);
+		return 1;
+	}
+
+	if (actigraphy->samples < SLEEP_EPOCH_SAMPLES)
+		return 2;
+
+	bool awake = scoreEpoch(actigraphy);
+	trace(TRACE_EPOCH, (int32_t) actigraphy->count, awake);
+	logEpoch(log, timestamp, awake);
+
+	// A restless epoch is time awake in bed, which counts as sitting
+	if (awake) {
+		counter->sitTime += elapsedSince(counter, timestamp);
+	} else {
+		counter->sleepTime += elapsedSince(counter, timestamp);
+	}
+	counter->timestamp = timestamp;
+
+	actigraphy->count = 0;
+	actigraphy->samples = 0;
+	actigraphy->wakeEpochs = awake ? actigraphy->wakeEpochs + 1 : 0;
+	if (actigraphy->wakeEpochs >= SLEEP_WAKE_EPOCHS) {
+		actigraphy->active = false;
+		LOG(APP_LOG_LEVEL_INFO, "Night mode: off (restless)");
+		return 1;
+	}
+	return 0;
+}
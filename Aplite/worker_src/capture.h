@@ -0,0 +1,55 @@
+#ifndef _CAPTURE_H_
+#define _CAPTURE_H_
+
+#include <pebble_worker.h>
+#include "sampling.h"
+
+#define CAPTURE_BLOCK_SIZE		20	// Samples per block
+#define CAPTURE_ITEM_SIZE		64	// Bytes per data logging item
+#define CAPTURE_DATA_LOG_TAG	2
+#define CAPTURE_INTERVAL_MS		SAMPLE_INTERVAL_MS	// Nominal time between two samples
+
+#define CAPTURE_MAGIC			0x314E4F	// "ON1"
+#define CAPTURE_VERSION			1
+
+/*
+ * Raw accelerometer capture. The data logging items, concatenated, start with a preamble (little endian):
+ *   uint8  magic[3]       "ON1"
+ *   uint8  version        CAPTURE_VERSION
+ *   uint8  rate           samples per second
+ *   uint8  blockSize      most samples in one block
+ * and go on with a stream of blocks:
+ *   uint8  count          samples in the block, 0 marks the padding at the end of the stream
+ *   uint8  label          activity type when the block started
+ *   uint64 timestamp      of the first sample, in ms
+ *   int16  x, y, z        of the first sample
+ *   uint8  widths[4]      bits per value for x, y, z and time
+ *   uint32 vibrate        did_vibrate of sample i in bit i
+ * followed by count - 1 deltas per column (all of x, then y, z and time), zig-zag encoded and packed LSB first
+ * with the column's width. Time deltas are relative to CAPTURE_INTERVAL_MS. The next block starts on the
+ * next byte boundary.
+ */
+typedef struct {
+	DataLoggingSessionRef session;
+	uint8_t item[CAPTURE_ITEM_SIZE];
+	uint32_t itemSize;
+	uint32_t bits;
+	uint32_t bitCount;
+
+	uint32_t count;
+	uint8_t label;
+	uint64_t timestamp;
+	uint64_t lastTimestamp;
+	uint32_t vibrate;
+	int16_t x[CAPTURE_BLOCK_SIZE];
+	int16_t y[CAPTURE_BLOCK_SIZE];
+	int16_t z[CAPTURE_BLOCK_SIZE];
+	uint16_t interval[CAPTURE_BLOCK_SIZE];
+} Capture;
+
+void startCapture(Capture* capture);
+void stopCapture(Capture* capture);
+bool isCapturing(Capture* capture);
+void captureSamples(Capture* capture, AccelData* acceleration, uint32_t size, uint32_t label);
+
+#endif
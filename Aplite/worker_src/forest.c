@@ -0,0 +1,147 @@
+#include "forest.h"
+
+// The quantization is built with either backend, so that the host tools can dump what the forest sees
+static int8_t quantizeLinear(double value, double scale) {
+	int32_t quantized = (int32_t) (value * scale);
+	if (quantized > INT8_MAX)
+		return INT8_MAX;
+	if (quantized < INT8_MIN)
+		return INT8_MIN;
+	return (int8_t) quantized;
+}
+
+
+// 4 * log2(x), with two fraction bits from the bits below the leading one. 31 whole bits make at most 127.
+static int8_t quantizeLog(double value) {
+	if (value < 1.0)
+		return 0;
+	uint32_t x = value >= 4294967295.0 ? UINT32_MAX : (uint32_t) value;
+	uint32_t bits = 31 - __builtin_clz(x);
+	uint32_t fraction = bits >= 2 ? (x >> (bits - 2)) & 3 : (x << (2 - bits)) & 3;
+	return (int8_t) (bits * 4 + fraction);
+}
+
+
+void quantizeFeature(Feature* feature, int8_t* quantized) {
+	quantized[FOREST_MEAN_V] = quantizeLinear(feature->meanV, 1.0);
+	quantized[FOREST_MEAN_H] = quantizeLinear(feature->meanH, 0.5);
+	quantized[FOREST_DEVIATION_V] = quantizeLog(feature->deviationV);
+	quantized[FOREST_DEVIATION_H] = quantizeLog(feature->deviationH);
+	quantized[FOREST_ENERGY_HF] = quantizeLog(feature->energyHF);
+	quantized[FOREST_PERIODICITY] = quantizeLinear(feature->periodicity, 100.0);
+	quantized[FOREST_CADENCE] = quantizeLinear(feature->cadence, 2.0);
+	quantized[FOREST_CADENCE_STRENGTH] = quantizeLinear(feature->cadenceStrength, 100.0);
+}
+
+
+#if CLASSIFIER_BACKEND == CLASSIFIER_FOREST
+
+#include "recognizer.h"
+
+#define FOREST_TREES	5
+
+// Written by tools/forest_train.py, see tools/README.md. Thresholds are on the quantized values.
+static const uint8_t ROOTS[FOREST_TREES] = { 0, 15, 30, 45, 60 };
+
+static const ForestNode NODES[] = {
+	{ FOREST_ENERGY_HF, 61, 1, 14 },	// Tree 0
+	{ FOREST_PERIODICITY, 80, 2, 9 },
+	{ FOREST_ENERGY_HF, 24, 3, 6 },
+	{ FOREST_DEVIATION_V, 19, 4, 5 },
+	{ FOREST_LEAF, 58, 0, 0 },
+	{ FOREST_LEAF, 94, 1, 0 },
+	{ FOREST_CADENCE_STRENGTH, 31, 7, 8 },
+	{ FOREST_LEAF, 97, 4, 0 },
+	{ FOREST_LEAF, 96, 1, 0 },
+	{ FOREST_ENERGY_HF, 41, 10, 13 },
+	{ FOREST_MEAN_V, 0, 11, 12 },
+	{ FOREST_LEAF, 91, 2, 0 },
+	{ FOREST_LEAF, 100, 2, 0 },
+	{ FOREST_LEAF, 100, 2, 0 },
+	{ FOREST_LEAF, 100, 3, 0 },
+	{ FOREST_DEVIATION_V, 59, 16, 29 },	// Tree 1
+	{ FOREST_PERIODICITY, 80, 17, 24 },
+	{ FOREST_ENERGY_HF, 24, 18, 21 },
+	{ FOREST_DEVIATION_V, 19, 19, 20 },
+	{ FOREST_LEAF, 58, 0, 0 },
+	{ FOREST_LEAF, 94, 1, 0 },
+	{ FOREST_DEVIATION_H, 14, 22, 23 },
+	{ FOREST_LEAF, 100, 4, 0 },
+	{ FOREST_LEAF, 100, 1, 0 },
+	{ FOREST_MEAN_H, 7, 25, 28 },
+	{ FOREST_PERIODICITY, 97, 26, 27 },
+	{ FOREST_LEAF, 92, 2, 0 },
+	{ FOREST_LEAF, 100, 2, 0 },
+	{ FOREST_LEAF, 100, 2, 0 },
+	{ FOREST_LEAF, 100, 3, 0 },
+	{ FOREST_MEAN_H, 41, 31, 44 },	// Tree 2
+	{ FOREST_PERIODICITY, 80, 32, 39 },
+	{ FOREST_DEVIATION_V, 18, 33, 36 },
+	{ FOREST_MEAN_H, 2, 34, 35 },
+	{ FOREST_LEAF, 57, 0, 0 },
+	{ FOREST_LEAF, 76, 0, 0 },
+	{ FOREST_DEVIATION_H, 13, 37, 38 },
+	{ FOREST_LEAF, 98, 4, 0 },
+	{ FOREST_LEAF, 98, 1, 0 },
+	{ FOREST_MEAN_H, 7, 40, 43 },
+	{ FOREST_ENERGY_HF, 47, 41, 42 },
+	{ FOREST_LEAF, 90, 2, 0 },
+	{ FOREST_LEAF, 100, 2, 0 },
+	{ FOREST_LEAF, 100, 2, 0 },
+	{ FOREST_LEAF, 100, 3, 0 },
+	{ FOREST_MEAN_H, 41, 46, 59 },	// Tree 3
+	{ FOREST_DEVIATION_V, 42, 47, 54 },
+	{ FOREST_ENERGY_HF, 24, 48, 51 },
+	{ FOREST_DEVIATION_V, 19, 49, 50 },
+	{ FOREST_LEAF, 58, 0, 0 },
+	{ FOREST_LEAF, 94, 1, 0 },
+	{ FOREST_CADENCE_STRENGTH, 30, 52, 53 },
+	{ FOREST_LEAF, 97, 4, 0 },
+	{ FOREST_LEAF, 94, 1, 0 },
+	{ FOREST_ENERGY_HF, 41, 55, 58 },
+	{ FOREST_MEAN_V, 0, 56, 57 },
+	{ FOREST_LEAF, 75, 2, 0 },
+	{ FOREST_LEAF, 99, 2, 0 },
+	{ FOREST_LEAF, 100, 2, 0 },
+	{ FOREST_LEAF, 100, 3, 0 },
+	{ FOREST_DEVIATION_V, 59, 61, 74 },	// Tree 4
+	{ FOREST_DEVIATION_V, 42, 62, 69 },
+	{ FOREST_ENERGY_HF, 24, 63, 66 },
+	{ FOREST_DEVIATION_V, 19, 64, 65 },
+	{ FOREST_LEAF, 58, 0, 0 },
+	{ FOREST_LEAF, 94, 1, 0 },
+	{ FOREST_DEVIATION_H, 14, 67, 68 },
+	{ FOREST_LEAF, 100, 4, 0 },
+	{ FOREST_LEAF, 100, 1, 0 },
+	{ FOREST_ENERGY_HF, 41, 70, 73 },
+	{ FOREST_DEVIATION_H, 34, 71, 72 },
+	{ FOREST_LEAF, 50, 1, 0 },
+	{ FOREST_LEAF, 100, 2, 0 },
+	{ FOREST_LEAF, 100, 2, 0 },
+	{ FOREST_LEAF, 100, 3, 0 }
+};
+
+
+// Every tree walks from its root to a leaf, the type with the most weight wins and ties go to the lower type
+uint32_t classify(Feature feature) {
+	int8_t quantized[FOREST_FEATURES];
+	quantizeFeature(&feature, quantized);
+
+	uint16_t votes[ACTIVITY_TYPES] = { 0 };
+	for (uint32_t tree = 0; tree < FOREST_TREES; tree++) {
+		const ForestNode* node = &NODES[ROOTS[tree]];
+		while (node->feature != FOREST_LEAF) {
+			node = &NODES[quantized[node->feature] <= node->threshold ? node->left : node->right];
+		}
+		votes[node->left] += node->threshold;
+	}
+
+	uint32_t type = 0;
+	for (uint32_t i = 1; i < ACTIVITY_TYPES; i++) {
+		if (votes[i] > votes[type])
+			type = i;
+	}
+	return type;
+}
+
+#endif
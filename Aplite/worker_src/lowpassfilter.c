@@ -36,17 +36,48 @@ uint32_t norm(int16_t x, int16_t y, int16_t z) {
 
 
 void initLowPassFilter(LowPassFilter* filter) {
-	double rate = 100.0;
-	double freq = 100.0;
-	double dt = 1.0 / rate;
-	double RC = 1.0 / freq;
-
-	filter->filterConstant = dt / (dt + RC);
+	filter->filterConstant = FILTER_CONSTANT;
 	filter->kAccelerometerMinStep = 0.02;
 	filter->kAccelerometerNoiseAttenuation = 3.0;
 	filter->x = 0;
 	filter->y = 0;
 	filter->z = 0;
+	filter->seeded = false;
+	filter->restored = false;
+}
+
+
+// Gravity estimate saved by a previous run, kept only if the first batch agrees with it
+void restoreLowPassFilter(LowPassFilter* filter, int16_t x, int16_t y, int16_t z) {
+	filter->x = x;
+	filter->y = y;
+	filter->z = z;
+	filter->restored = true;
+}
+
+
+// Start from the mean of the first batch instead of converging up from zero. Returns true if a saved estimate
+// was kept, and how far the batch mean was from the previous estimate.
+bool seedLowPassFilter(LowPassFilter* filter, AccelData* samples, uint32_t size, uint32_t* distance) {
+	int32_t x = 0, y = 0, z = 0;
+	for (uint32_t i = 0; i < size; i++) {
+		x += samples[i].x;
+		y += samples[i].y;
+		z += samples[i].z;
+	}
+	x /= (int32_t) size;
+	y /= (int32_t) size;
+	z /= (int32_t) size;
+
+	*distance = norm(x - filter->x, y - filter->y, z - filter->z);
+	bool keep = filter->restored && *distance <= FILTER_SEED_TOLERANCE;
+	if (!keep) {
+		filter->x = x;
+		filter->y = y;
+		filter->z = z;
+	}
+	filter->seeded = true;
+	return keep;
 }
 
 
@@ -2,6 +2,9 @@
 #define _LOWPASSFILTER_H_
 
 #include <pebble_worker.h>
+#include "sampling.h"
+
+#define FILTER_SEED_TOLERANCE	150	// mG, a saved gravity estimate further than this from the first batch is stale
 
 typedef struct {
 	double kAccelerometerMinStep;
@@ -10,12 +13,16 @@ typedef struct {
 	int16_t x;
 	int16_t y;
 	int16_t z;
+	bool seeded;	// Has a gravity estimate, either from the first batch or restored
+	bool restored;	// The estimate was saved by a previous run, check it against the first batch
 } LowPassFilter;
 
 uint32_t wdSqrt(uint32_t n);
 uint32_t norm(int16_t x, int16_t y, int16_t z);
 double clamp(double v, double min, double max);
 void initLowPassFilter(LowPassFilter* filter);
+void restoreLowPassFilter(LowPassFilter* filter, int16_t x, int16_t y, int16_t z);
+bool seedLowPassFilter(LowPassFilter* filter, AccelData* samples, uint32_t size, uint32_t* distance);
 void goThroughFilter(LowPassFilter* filter, int16_t x, int16_t y, int16_t z);
 
 #endif
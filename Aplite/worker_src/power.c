@@ -0,0 +1,67 @@
+#include "power.h"
+
+// Highest charge of each tier below POWER_FULL
+static const uint8_t THRESHOLDS[POWER_TIERS - 1] = { POWER_NO_OVERLAP_PERCENT, POWER_MOTION_GATED_PERCENT, POWER_SUSPEND_PERCENT };
+
+
+void initPower(Power* power) {
+	power->tier = POWER_FULL;
+	power->stillBatches = 0;
+	power->wakeUntil = 0;
+}
+
+
+// Down as soon as the charge reaches a threshold, back up only with some margin so that a reading
+// flickering around a threshold does not flap the pipeline. On the charger everything runs.
+uint32_t choosePowerTier(uint32_t tier, BatteryChargeState state) {
+	if (state.is_charging || state.is_plugged)
+		return POWER_FULL;
+
+	uint32_t target = POWER_FULL;
+	while (target < POWER_TIERS - 1 && state.charge_percent <= THRESHOLDS[target]) {
+		target++;
+	}
+	if (target >= tier)
+		return target;
+
+	while (tier > target && state.charge_percent > THRESHOLDS[tier - 1] + POWER_HYSTERESIS_PERCENT) {
+		tier--;
+	}
+	return tier;
+}
+
+
+// Returns true while the recognizer should see the batch: it moved, or it is one of the first still ones,
+// which lets the window that was filling when it stopped moving finish.
+// Works on squared magnitudes so that the gate costs no square root per sample: near the mean m,
+// |x² - m²| is about 2m|x - m|, so a mean deviation of the magnitude of POWER_MOTION_THRESHOLD is a
+// mean deviation of the squares of 2 m POWER_MOTION_THRESHOLD, and both sides are squared once more
+// to compare against m² itself.
+bool gateMotion(Power* power, AccelData* acceleration, uint32_t size) {
+	if (size == 0)
+		return true;
+
+	uint32_t squares[size];
+	uint64_t sum = 0;
+	for (uint32_t i = 0; i < size; i++) {
+		int32_t x = acceleration[i].x;
+		int32_t y = acceleration[i].y;
+		int32_t z = acceleration[i].z;
+		squares[i] = (uint32_t) (x * x + y * y + z * z);
+		sum += squares[i];
+	}
+	uint32_t mean = (uint32_t) (sum / size);
+
+	uint64_t deviation = 0;
+	for (uint32_t i = 0; i < size; i++) {
+		deviation += squares[i] > mean ? squares[i] - mean : mean - squares[i];
+	}
+
+	uint64_t bound = 2 * POWER_MOTION_THRESHOLD * (uint64_t) size;
+	if (deviation * deviation >= bound * bound * mean) {
+		power->stillBatches = 0;
+		return true;
+	}
+	power->stillBatches++;
+	return power->stillBatches <= POWER_STILL_BATCHES;
+}
@@ -0,0 +1,60 @@
+#include "profiler.h"
+
+void resetProfiler(Profiler* profiler) {
+	memset(profiler, 0, sizeof(Profiler));
+}
+
+
+// Milliseconds, wraps around every 49 days
+uint32_t profilerClock() {
+	time_t seconds;
+	uint16_t milliseconds;
+	time_ms(&seconds, &milliseconds);
+	return (uint32_t) seconds * 1000 + milliseconds;
+}
+
+
+void countEvent(Profiler* profiler, uint32_t counter, uint32_t amount) {
+	profiler->counters[counter] += amount;
+}
+
+
+void recordWindowTime(Profiler* profiler, uint32_t start) {
+	uint32_t elapsed = profilerClock() - start;
+
+	// log2 bucket: 0 ms goes to bucket 0, [2^(k-1), 2^k) ms goes to bucket k
+	uint32_t bucket = 0;
+	while (elapsed > 0 && bucket < PROFILER_BUCKETS - 1) {
+		elapsed >>= 1;
+		bucket++;
+	}
+	profiler->windowTime[bucket]++;
+}
+
+
+void sampleHeap(Profiler* profiler) {
+	uint32_t used = heap_bytes_used();
+	if (used > profiler->heapHighWater) {
+		profiler->heapHighWater = used;
+	}
+}
+
+
+// One message per value: data0 is the index (counters first, then the histogram, then the heap high-water mark), data1 and data2 the low and high halves
+void sendProfilerReport(Profiler* profiler, uint16_t type) {
+	AppWorkerMessage message;
+	for (uint16_t i = 0; i <= PROFILER_COUNTERS + PROFILER_BUCKETS; i++) {
+		uint32_t value;
+		if (i < PROFILER_COUNTERS) {
+			value = profiler->counters[i];
+		} else if (i < PROFILER_COUNTERS + PROFILER_BUCKETS) {
+			value = profiler->windowTime[i - PROFILER_COUNTERS];
+		} else {
+			value = profiler->heapHighWater;
+		}
+		message.data0 = i;
+		message.data1 = (uint16_t) (value & 0xFFFF);
+		message.data2 = (uint16_t) (value >> 16);
+		app_worker_send_message(type, &message);
+	}
+}
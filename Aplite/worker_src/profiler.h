@@ -0,0 +1,35 @@
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#include <pebble_worker.h>
+
+#define PROFILER_BUCKETS	12	// Window time buckets: 0, 1, 2-3, 4-7, ..., 1024+ ms
+
+enum {
+	PROFILER_ACCEL_CALLBACKS = 0,
+	PROFILER_SAMPLES,
+	PROFILER_WINDOWS,
+	PROFILER_STATUS_MESSAGES,
+	PROFILER_PERSIST_WRITES,
+	PROFILER_DATA_LOGS,
+	PROFILER_RAW_TYPE_CHANGES,	// Windows where classify() changed its mind
+	PROFILER_TYPE_CHANGES,	// Windows where the smoothed type changed
+	PROFILER_GATED_BATCHES,	// Batches the motion gate kept from the recognizer
+	PROFILER_SUSPENDED_MINUTES,	// Minutes with the accelerometer off
+	PROFILER_COUNTERS
+};
+
+typedef struct {
+	uint32_t counters[PROFILER_COUNTERS];
+	uint32_t windowTime[PROFILER_BUCKETS];	// Histogram of per-window processing time
+	uint32_t heapHighWater;	// Most heap bytes seen in use at any sample point
+} Profiler;
+
+void resetProfiler(Profiler* profiler);
+uint32_t profilerClock();
+void countEvent(Profiler* profiler, uint32_t counter, uint32_t amount);
+void recordWindowTime(Profiler* profiler, uint32_t start);
+void sampleHeap(Profiler* profiler);
+void sendProfilerReport(Profiler* profiler, uint16_t type);
+
+#endif
@@ -5,12 +5,57 @@
 #include "utility.h"
 #include "lowpassfilter.h"
 #include "classifier.h"
+#include "trace.h"
+#include "kernels.h"
+#include "sampling.h"
 
-#define SAMPLE_INTERVAL_S	8
-#define BATCH_SIZE			10
-#define SAMPLE_SIZE			(SAMPLE_INTERVAL_S * BATCH_SIZE)
-#define MAX_WALKING_SPEED	3	// 3 steps per second
+// Goertzel bins for the step cadence: 1, 1.5, 2, ..., 3.5 Hz. The bank runs over 2 s blocks, which makes each
+// bin 0.5 Hz wide and a whole number of cycles per block, so the block mean does not leak into them.
+#define CADENCE_BINS		6
+#define CADENCE_FIRST_BIN	2	// In half hertz
+#define CADENCE_BLOCK_SIZE	(2 * SAMPLE_RATE_HZ)
+#define CADENCE_MIN_STRENGTH	0.3	// Below this there is no clear rhythm
 
-uint32_t analyzeAcceleration(uint32_t* currentType, Counter* counter, LowPassFilter* filter, bool isDriving, int32_t sensitivity, AccelData* acceleration, uint32_t size);
+// Label smoothing: costs are -log2 probabilities in eighths of a bit. Staying is 90% likely, each of the
+// four other types 2.5%. classify() is right 70% of the time and picks each wrong type 7.5% of the time.
+// A lone odd window is ignored, two in a row switch the label.
+#define ACTIVITY_TYPES			5
+#define SMOOTHING_STAY_COST		1
+#define SMOOTHING_SWITCH_COST	42
+#define SMOOTHING_MATCH_COST	4
+#define SMOOTHING_MISMATCH_COST	30
+
+// All the state of one recognizer, so that several of them can run side by side
+typedef struct {
+	LowPassFilter filter;
+	uint32_t dataSize;
+	Projection window[SAMPLE_SIZE];
+	int16_t maxV;
+	int16_t minV;
+	uint16_t cost[ACTIVITY_TYPES];	// Smoothing: cost of the best label history ending in each type
+	uint32_t rawType;	// Last label from classify(), before smoothing
+	bool overlap;	// Windows slide by half their length, otherwise by all of it
+	TraceSink sink;	// Where this recognizer's trace events go, NULL for nowhere
+} Recognizer;
+
+// What a relaunched worker needs to classify its first window: the gravity estimate and the last label
+typedef struct {
+	int16_t x;
+	int16_t y;
+	int16_t z;
+	uint16_t type;
+} RecognizerState;
+
+void initRecognizer(Recognizer* recognizer);
+void clearWindow(Recognizer* recognizer);
+void setOverlap(Recognizer* recognizer, bool overlap);
+uint32_t windowHop(Recognizer* recognizer);
+void saveRecognizer(Recognizer* recognizer, uint32_t currentType, RecognizerState* state);
+void restoreRecognizer(Recognizer* recognizer, uint32_t* currentType, RecognizerState* state);
+// The pieces of analyzeAcceleration, usable on their own for parameter sweeps
+void extractFeature(Recognizer* recognizer, Feature* feature);
+uint32_t smoothType(Recognizer* recognizer, uint32_t observed);
+uint32_t countSteps(Recognizer* recognizer, Feature* feature, uint32_t type, int32_t sensitivity);
+uint32_t analyzeAcceleration(Recognizer* recognizer, uint32_t* currentType, Counter* counter, uint32_t timestamp, bool isDriving, int32_t sensitivity, AccelData* acceleration, uint32_t size);
 
 #endif
@@ -0,0 +1,11 @@
+#ifndef _ROLLUP_H_
+#define _ROLLUP_H_
+
+#include <pebble_worker.h>
+#include "utility.h"
+
+void initRollup(Rollup* rollup, uint32_t now);
+void addToRollup(Rollup* rollup, uint32_t now, Counter* previous, Counter* current);
+void closeRollupDays(Rollup* rollup, uint32_t days, uint32_t weekday);
+
+#endif
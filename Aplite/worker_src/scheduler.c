@@ -0,0 +1,46 @@
+#include "scheduler.h"
+
+static void findNext(Scheduler* scheduler) {
+	scheduler->next = SCHEDULER_NEVER;
+	for (uint32_t i = 0; i < scheduler->size; i++) {
+		if (scheduler->deadlines[i] < scheduler->next)
+			scheduler->next = scheduler->deadlines[i];
+	}
+}
+
+
+void initScheduler(Scheduler* scheduler) {
+	scheduler->size = 0;
+	scheduler->next = SCHEDULER_NEVER;
+}
+
+
+uint32_t addDuty(Scheduler* scheduler, DutyHandler handler, uint32_t deadline) {
+	uint32_t duty = scheduler->size++;
+	scheduler->handlers[duty] = handler;
+	scheduler->deadlines[duty] = deadline;
+	findNext(scheduler);
+	return duty;
+}
+
+
+void setDeadline(Scheduler* scheduler, uint32_t duty, uint32_t deadline) {
+	scheduler->deadlines[duty] = deadline;
+	findNext(scheduler);
+}
+
+
+// Due duties run in the order they were added
+void runDuties(Scheduler* scheduler, uint32_t now) {
+	if (! hasDueDuty(scheduler, now))
+		return;
+
+	for (uint32_t i = 0; i < scheduler->size; i++) {
+		if (now >= scheduler->deadlines[i]) {
+			// Never run twice for the same deadline, even if the handler forgets to move it
+			scheduler->deadlines[i] = SCHEDULER_NEVER;
+			scheduler->handlers[i](now);
+		}
+	}
+	findNext(scheduler);
+}
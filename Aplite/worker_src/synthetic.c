@@ -0,0 +1,87 @@
+#include "synthetic.h"
+
+// A day of typical activities, played in a loop
+static const Segment SCHEDULE[] = {
+	{ 0, 1800, 0, 0, 0, 0 },	// Sleep
+	{ 1, 600, 0, 0, 0, 0 },	// Sit
+	{ 2, 900, 110, 250, 150, 0 },	// Walk
+	{ 1, 300, 0, 0, 0, 0 },
+	{ 4, 1200, 0, 0, 0, 40 },	// Drive
+	{ 2, 600, 95, 180, 100, 0 },
+	{ 3, 900, 165, 700, 400, 0 },	// Jog
+	{ 1, 1200, 0, 0, 0, 0 }
+};
+#define SCHEDULE_SIZE	(sizeof(SCHEDULE) / sizeof(Segment))
+
+// Wrist orientations, as the angle of gravity away from -z around the x axis
+static const int32_t ORIENTATIONS[] = { 0, TRIG_MAX_ANGLE / 12, TRIG_MAX_ANGLE / 5, TRIG_MAX_ANGLE / 3 };
+#define ORIENTATION_COUNT	(sizeof(ORIENTATIONS) / sizeof(int32_t))
+
+
+// xorshift32, uniform in [-amplitude, amplitude]
+static int32_t randomize(Synthetic* synthetic, int32_t amplitude) {
+	synthetic->seed ^= synthetic->seed << 13;
+	synthetic->seed ^= synthetic->seed >> 17;
+	synthetic->seed ^= synthetic->seed << 5;
+	if (amplitude <= 0)
+		return 0;
+	return (int32_t) (synthetic->seed % (uint32_t) (amplitude * 2 + 1)) - amplitude;
+}
+
+
+static void orient(Synthetic* synthetic) {
+	int32_t angle = ORIENTATIONS[(synthetic->segment + synthetic->seed) % ORIENTATION_COUNT];
+	synthetic->gravityX = 0;
+	synthetic->gravityY = SYNTHETIC_GRAVITY * sin_lookup(angle) / TRIG_MAX_RATIO;
+	synthetic->gravityZ = -SYNTHETIC_GRAVITY * cos_lookup(angle) / TRIG_MAX_RATIO;
+}
+
+
+void initSynthetic(Synthetic* synthetic, uint32_t seed, uint64_t timestamp) {
+	memset(synthetic, 0, sizeof(Synthetic));
+	synthetic->seed = seed != 0 ? seed : 1;
+	synthetic->noise = 8;
+	synthetic->timestamp = timestamp;
+	orient(synthetic);
+}
+
+
+void generateSamples(Synthetic* synthetic, AccelData* samples, uint32_t size) {
+	for (uint32_t i = 0; i < size; i++) {
+		const Segment* segment = &SCHEDULE[synthetic->segment];
+
+		// Vertical bounce once per step, arm swing once per stride
+		int32_t v = 0;
+		int32_t h = 0;
+		if (segment->cadence > 0) {
+			v = segment->bounce * sin_lookup(synthetic->phase % TRIG_MAX_ANGLE) / TRIG_MAX_RATIO;
+			h = segment->swing * sin_lookup(synthetic->phase / 2) / TRIG_MAX_RATIO;
+
+			// The phase runs over a whole stride, a step is done every time it passes TRIG_MAX_ANGLE
+			uint32_t advance = TRIG_MAX_ANGLE * segment->cadence / (60 * SYNTHETIC_RATE);
+			synthetic->steps += (synthetic->phase % TRIG_MAX_ANGLE + advance) / TRIG_MAX_ANGLE;
+			synthetic->phase = (synthetic->phase + advance) % (TRIG_MAX_ANGLE * 2);
+		}
+		v += randomize(synthetic, segment->vibration);
+
+		// v is along gravity, h along x which is always perpendicular to it
+		samples[i].x = (int16_t) (h + randomize(synthetic, synthetic->noise));
+		samples[i].y = (int16_t) (synthetic->gravityY + v * synthetic->gravityY / SYNTHETIC_GRAVITY + randomize(synthetic, synthetic->noise));
+		samples[i].z = (int16_t) (synthetic->gravityZ + v * synthetic->gravityZ / SYNTHETIC_GRAVITY + randomize(synthetic, synthetic->noise));
+		samples[i].did_vibrate = false;
+		samples[i].timestamp = synthetic->timestamp;
+		synthetic->timestamp += 1000 / SYNTHETIC_RATE;
+
+		synthetic->sample++;
+		if (synthetic->sample >= (uint32_t) segment->seconds * SYNTHETIC_RATE) {
+			synthetic->sample = 0;
+			synthetic->segment = (synthetic->segment + 1) % SCHEDULE_SIZE;
+			orient(synthetic);
+		}
+	}
+}
+
+
+uint32_t syntheticLabel(Synthetic* synthetic) {
+	return SCHEDULE[synthetic->segment].label;
+}
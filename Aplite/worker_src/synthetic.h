@@ -0,0 +1,44 @@
+#ifndef _SYNTHETIC_H_
+#define _SYNTHETIC_H_
+
+#include <pebble_worker.h>
+#include "sampling.h"
+
+#define SYNTHETIC_RATE		SAMPLE_RATE_HZ	// Samples per second
+#define SYNTHETIC_GRAVITY	1000	// mG
+
+// One stretch of a single activity
+typedef struct {
+	uint8_t label;	// Activity type the recognizer should report
+	uint16_t seconds;
+	uint16_t cadence;	// Steps per minute, 0 for none
+	int16_t bounce;	// Vertical amplitude per step, mG
+	int16_t swing;	// Horizontal arm swing amplitude, mG
+	int16_t vibration;	// Random vehicle vibration amplitude, mG
+} Segment;
+
+/*
+ * Deterministic accelerometer traces: gravity in a per-segment orientation, sensor noise, a vertical
+ * bounce at step cadence, arm swing at half cadence and vehicle vibration. The same seed always gives the
+ * same samples, so runs on the emulator or the watch can be compared to each other and to the ground truth.
+ */
+typedef struct {
+	uint32_t seed;
+	int16_t noise;	// Sensor noise amplitude, mG
+
+	uint32_t segment;
+	uint32_t sample;	// Within the segment
+	uint32_t phase;	// Stride phase, TRIG_MAX_ANGLE per step
+	uint64_t timestamp;	// ms
+	int32_t gravityX;
+	int32_t gravityY;
+	int32_t gravityZ;
+
+	uint32_t steps;	// Ground truth so far
+} Synthetic;
+
+void initSynthetic(Synthetic* synthetic, uint32_t seed, uint64_t timestamp);
+void generateSamples(Synthetic* synthetic, AccelData* samples, uint32_t size);
+uint32_t syntheticLabel(Synthetic* synthetic);
+
+#endif
@@ -1,5 +1,84 @@
+// History export: the watch sends its rollup in chunks, we ack in order and resume on stalls
+var EXPORT_RECORD_SIZE = 20;	// start, length, steps, 4 x minutes, little endian
+var EXPORT_DAYS = 7;	// Pulled on every start
+var EXPORT_STALL_MS = 10000;	// Ask again from the next expected chunk after this long without data
+
+var mExport = null;
+
+function readUint(bytes, offset, size) {
+	var value = 0;
+	for (var i = size - 1; i >= 0; i--) {
+		value = value * 256 + bytes[offset + i];
+	}
+	return value;
+}
+
+function sendExportMessage(message) {
+	Pebble.sendAppMessage(
+		message,
+		function(e) {},
+		function(e) {
+			console.log("Unable to deliver export message with transactionId=" + e.data.transactionId);
+		}
+	);
+}
+
+function armExportTimer() {
+	clearTimeout(mExport.timer);
+	mExport.timer = setTimeout(function() {
+		if (mExport == null) {
+			return;
+		}
+		console.log("Export stalled, resuming from chunk " + mExport.nextSeq);
+		requestHistory(mExport.from, mExport.to, mExport.nextSeq);
+	}, EXPORT_STALL_MS);
+}
+
+// Seconds since the epoch, [from, to)
+function requestHistory(from, to, seq) {
+	if (mExport == null || mExport.from != from || mExport.to != to || seq == 0) {
+		mExport = { from: from, to: to, nextSeq: 0, records: [], timer: null };
+	}
+	sendExportMessage({ "exportFrom": from, "exportTo": to, "exportSeq": mExport.nextSeq });
+	armExportTimer();
+}
+
+function handleExportChunk(payload) {
+	if (mExport == null) {
+		return;
+	}
+
+	// Out of order chunks are dropped, the ack tells the watch where to go on
+	if (payload.exportSeq == mExport.nextSeq) {
+		var bytes = payload.exportData || [];
+		for (var offset = 0; offset + EXPORT_RECORD_SIZE <= bytes.length; offset += EXPORT_RECORD_SIZE) {
+			mExport.records.push({
+				start: readUint(bytes, offset, 4),
+				length: readUint(bytes, offset + 4, 4),
+				steps: readUint(bytes, offset + 8, 4),
+				minutes: [readUint(bytes, offset + 12, 2), readUint(bytes, offset + 14, 2),
+						readUint(bytes, offset + 16, 2), readUint(bytes, offset + 18, 2)]
+			});
+		}
+		mExport.nextSeq++;
+	}
+	sendExportMessage({ "exportAck": mExport.nextSeq });
+
+	if (payload.exportDone !== undefined && mExport.nextSeq == payload.exportDone) {
+		clearTimeout(mExport.timer);
+		console.log("Export done: " + mExport.records.length + " records");
+		localStorage.setItem("history", JSON.stringify(mExport.records));
+		mExport = null;
+	} else {
+		armExportTimer();
+	}
+}
+
 Pebble.addEventListener("ready", function(e) {
 	console.log("On11 watchface is ready! " + e.ready);
+
+	var now = Math.floor(Date.now() / 1000);
+	requestHistory(now - EXPORT_DAYS * 86400, now, 0);
 });
 
 Pebble.addEventListener("showConfiguration", function() {
@@ -14,3 +93,9 @@ Pebble.addEventListener("webviewclosed", function(e) {
 		Pebble.sendAppMessage(options);
 	}
 });
+
+Pebble.addEventListener("appmessage", function(e) {
+	if (e.payload.exportSeq !== undefined) {
+		handleExportChunk(e.payload);
+	}
+});
@@ -1,5 +1,6 @@
 #include <pebble.h>
 #include "utility.h"
+#include "export.h"
 
 // AppMessage
 enum {
@@ -27,6 +28,14 @@ static uint32_t mCurrentType = 0;
 static bool mIsBluetoothConnected = true;
 static BatteryChargeState mBatteryChargeState;
 
+// Traffic, logged and cleared every hour
+static uint32_t mWorkerMessages = 0;
+static uint32_t mWorkerBytes = 0;
+static uint32_t mAppMessages = 0;
+static uint32_t mAppBytes = 0;
+static uint32_t mRedraws = 0;
+static uint32_t mHeapHighWater = 0;	// Most heap bytes seen in use, never cleared
+
 
 static void loadConfig() {
 	mResetTime = persist_exists(6) ? persist_read_int(6) : 0;
@@ -69,8 +78,31 @@ static void processBluetoothConnectionEvent(bool connected) {
 }
 
 
+static void sampleHeap() {
+	uint32_t used = heap_bytes_used();
+	if (used > mHeapHighWater) {
+		mHeapHighWater = used;
+	}
+}
+
+
+static void logTraffic() {
+	APP_LOG(APP_LOG_LEVEL_INFO, "Last hour: %lu worker messages (%lu bytes), %lu app messages (%lu bytes), %lu redraws, heap high-water %lu bytes",
+		mWorkerMessages, mWorkerBytes, mAppMessages, mAppBytes, mRedraws, mHeapHighWater);
+	mWorkerMessages = 0;
+	mWorkerBytes = 0;
+	mAppMessages = 0;
+	mAppBytes = 0;
+	mRedraws = 0;
+}
+
+
 // Render clock
 static void updateClock(struct tm* tickTime, TimeUnits unitsChanged) {
+	if (tickTime->tm_min == 0) {
+		logTraffic();
+	}
+
 	layer_mark_dirty(mWatchfaceLayer);
 }
 
@@ -249,6 +281,8 @@ static void drawProgress(GContext* context, GColor strokeColor, GColor innerColo
 
 // Render window
 static void updateWatchface(Layer* layer, GContext* context) {
+	mRedraws++;
+
 	GRect bounds = layer_get_frame(layer);
 	GPoint centerPoint = grect_center_point(&bounds);
 	uint16_t adjustment = 16;
@@ -396,6 +430,13 @@ static void sendConfigToWorker() {
 // App Message Sync
 static void messageReceived(DictionaryIterator* received, void* context) {
 	APP_LOG(APP_LOG_LEVEL_INFO, "App Message: Received");
+	mAppMessages++;
+	mAppBytes += dict_size(received);
+	sampleHeap();
+
+	// History export requests and acks
+	if (handleExportMessage(received, mResetTime))
+		return;
 
 	Tuple* resetTuple = dict_find(received, RESET_TIME_KEY);
 	Tuple* sensitivityTuple = dict_find(received, PEDOMETER_SENSITIVITY_KEY);
@@ -422,15 +463,20 @@ static void messageDropped(AppMessageResult reason, void* context) {
 
 static void messageSent(DictionaryIterator* sent, void* context) {
 	APP_LOG(APP_LOG_LEVEL_INFO, "App Message: Sent");
+	exportSent();
 }
 
 
 static void messageFailed(DictionaryIterator* sent, AppMessageResult reason, void* context) {
 	APP_LOG(APP_LOG_LEVEL_INFO, "App Message: Failed");
+	exportFailed();
 }
 
 
 static void workerMessageReceived(uint16_t type, AppWorkerMessage *data) {
+	mWorkerMessages++;
+	mWorkerBytes += sizeof(uint16_t) + sizeof(AppWorkerMessage);
+
 	switch (type) {
 		case 0:
 			mCounter.sleepTime = (uint32_t) data->data0;
@@ -451,6 +497,9 @@ static void workerMessageReceived(uint16_t type, AppWorkerMessage *data) {
 			mCurrentType = (uint32_t) data->data0;
 			layer_mark_dirty(mWatchfaceLayer);
 			break;
+		case 110:	// Worker profiler report
+			APP_LOG(APP_LOG_LEVEL_INFO, "Worker profiler %d: %lu", data->data0, ((uint32_t) data->data2 << 16) | data->data1);
+			break;
 		default:
 			break;
 	}
@@ -466,6 +515,8 @@ static void windowLoad(Window *window) {
 	
 	// Register function for update
 	layer_set_update_proc(mWatchfaceLayer, updateWatchface);
+
+	sampleHeap();
 }
 
 
@@ -499,7 +550,9 @@ static void init(void) {
 	app_message_register_outbox_sent(&messageSent);
 	app_message_register_outbox_failed(&messageFailed);
 	// https://developer.getpebble.com/2/api-reference/group___dictionary.html#ga0551d069624fb5bfc066fecfa4153bde
-	app_message_open(56, 12);
+	// The inbox fits the biggest message the phone sends, the settings with four integers; export requests have
+	// three and acks one. The outbox is sized for history export chunks.
+	app_message_open(dict_calc_buffer_size(4, sizeof(int32_t), sizeof(int32_t), sizeof(int32_t), sizeof(int32_t)), initExport());
 
 	// For main window
 	mWindow = window_create();
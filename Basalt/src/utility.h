@@ -10,4 +10,66 @@ typedef struct {
 	uint32_t timestamp;
 } Counter;
 
+// Seconds to credit since the counter's last update. The clock can be set back, which credits nothing.
+static inline uint32_t elapsedSince(const Counter* counter, uint32_t now) {
+	return now > counter->timestamp ? now - counter->timestamp : 0;
+}
+
+#define ROLLUP_HOURS	24
+#define ROLLUP_DAYS		7
+#define ROLLUP_WEEKS	4
+#define ROLLUP_TYPES	4	// Sleep, sit (and driving), walk, jog
+#define ROLLUP_KEY		13	// Persist key of the blob
+
+// Hourly, daily and weekly totals, kept by the worker and stored as one persist blob (252 of the 256 bytes allowed),
+// so the watchface reads them with a single persist_read_data(). Each ring's current bucket is at its slot, the
+// previous one just before it. Time is in minutes, an hour packs its four counts in 6 bits each.
+typedef struct {
+	uint32_t hourEnd;	// When the current hour bucket closes
+	uint32_t weekSteps[ROLLUP_WEEKS];
+	uint16_t hourSteps[ROLLUP_HOURS];
+	uint16_t daySteps[ROLLUP_DAYS];
+	uint16_t dayMinutes[ROLLUP_DAYS][ROLLUP_TYPES];
+	uint16_t weekMinutes[ROLLUP_WEEKS][ROLLUP_TYPES];
+	uint8_t hourMinutes[ROLLUP_HOURS][3];
+	uint8_t seconds[ROLLUP_TYPES];	// Left over until they make a whole minute
+	uint8_t hourSlot;
+	uint8_t daySlot;
+	uint8_t weekSlot;
+} Rollup;
+
+static inline uint32_t getHourMinutes(const Rollup* rollup, uint32_t slot, uint32_t type) {
+	const uint8_t* packed = rollup->hourMinutes[slot];
+	uint32_t bits = packed[0] | (packed[1] << 8) | (packed[2] << 16);
+	return (bits >> (type * 6)) & 0x3F;
+}
+
+#define SLEEP_LOG_EPOCHS	720	// One-minute epochs kept for the current night, 12 hours
+#define SLEEP_LOG_NIGHTS	7
+#define SLEEP_LOG_KEY		14	// Persist key of the blob
+
+// One stretch of night mode, as scored minute by minute
+typedef struct {
+	uint32_t start;	// Start of the first epoch
+	uint16_t epochs;	// Scored epochs, wake included
+	uint16_t wakeEpochs;
+	uint16_t wakeBouts;	// Runs of wake epochs
+	uint16_t longestBout;	// Longest of them, in epochs
+} SleepNight;
+
+// Sleep structure, kept by the worker and stored as one persist blob (196 bytes) next to the rollup: the current
+// night epoch by epoch, earlier nights as summaries. A night goes on across short trips out of night mode.
+typedef struct {
+	SleepNight night;	// The current night
+	uint32_t last;	// End of its latest epoch
+	uint8_t wake[SLEEP_LOG_EPOCHS / 8];	// Wake epochs of the current night, a bit each
+	SleepNight nights[SLEEP_LOG_NIGHTS];	// Earlier nights, the latest at nightSlot
+	uint8_t nightSlot;
+	uint8_t bout;	// Length of the wake bout in progress
+} SleepLog;
+
+static inline bool isWakeEpoch(const SleepLog* log, uint32_t epoch) {
+	return epoch < SLEEP_LOG_EPOCHS && ((log->wake[epoch / 8] >> (epoch % 8)) & 1);
+}
+
 #endif
@@ -0,0 +1,39 @@
+#ifndef _ACTIGRAPHY_H_
+#define _ACTIGRAPHY_H_
+
+#include <pebble_worker.h>
+#include "utility.h"
+#include "sampling.h"
+
+#define SLEEP_ENTRY_WINDOWS	(120 / SAMPLE_INTERVAL_S)	// Consecutive sleep windows (one minute) before switching to night mode
+#define SLEEP_EPOCH_SAMPLES	(60 * SAMPLE_RATE_HZ)	// One minute
+#define SLEEP_SCORE_EPOCHS	5	// Current epoch and the four before it
+#define SLEEP_COUNT_SCALE	(10 * SAMPLE_RATE_HZ)	// Activity count units per scoring unit, counts grow with the rate
+#define SLEEP_WAKE_SCORE	60000	// Weighted score at or above which an epoch is scored as wake
+#define SLEEP_WAKE_EPOCHS	3	// Consecutive wake epochs that end night mode
+#define SLEEP_EXIT_COUNT	(3000 * SAMPLE_RATE_HZ)	// Activity within one epoch that ends night mode right away
+#define SLEEP_EPOCH_S		60
+#define SLEEP_NIGHT_GAP_S	(60 * 60)	// Back in night mode within an hour, the same night goes on
+
+/*
+ * Night mode: once the classifier has seen sleep for a while, the worker stops classifying windows and only
+ * sums how far each sample's magnitude strays from a slow moving baseline. Every minute the count is scored
+ * with a causal Cole-Kripke style weighted sum of the recent epochs.
+ */
+typedef struct {
+	bool active;
+	uint32_t sleepWindows;	// Consecutive sleep windows seen by the full pipeline
+	int32_t baseline;	// Slow moving average of the magnitude, mG
+	uint32_t count;	// Activity count of the current epoch
+	uint32_t samples;	// Samples in the current epoch
+	uint16_t epochs[SLEEP_SCORE_EPOCHS];	// Scaled counts of the latest epochs, newest first
+	uint32_t wakeEpochs;	// Consecutive epochs scored as wake
+} Actigraphy;
+
+void noteActivity(Actigraphy* actigraphy, uint32_t type);
+bool isSleeping(Actigraphy* actigraphy);
+uint32_t trackSleep(Actigraphy* actigraphy, SleepLog* log, Counter* counter, uint32_t timestamp, AccelData* acceleration, uint32_t size);
+void initSleepLog(SleepLog* log);
+void logEpoch(SleepLog* log, uint32_t timestamp, bool awake);
+
+#endif
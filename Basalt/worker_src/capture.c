@@ -0,0 +1,171 @@
+#include "capture.h"
+
+static void putByte(Capture* capture, uint8_t byte) {
+	capture->item[capture->itemSize++] = byte;
+	if (capture->itemSize == CAPTURE_ITEM_SIZE) {
+		data_logging_log(capture->session, capture->item, 1);
+		capture->itemSize = 0;
+	}
+}
+
+
+static void putBits(Capture* capture, uint32_t value, uint32_t width) {
+	for (uint32_t i = 0; i < width; i++) {
+		capture->bits |= ((value >> i) & 1) << capture->bitCount;
+		capture->bitCount++;
+		if (capture->bitCount == 8) {
+			putByte(capture, (uint8_t) capture->bits);
+			capture->bits = 0;
+			capture->bitCount = 0;
+		}
+	}
+}
+
+
+static void alignBits(Capture* capture) {
+	if (capture->bitCount > 0) {
+		putByte(capture, (uint8_t) capture->bits);
+		capture->bits = 0;
+		capture->bitCount = 0;
+	}
+}
+
+
+static uint32_t zigzag(int32_t value) {
+	return ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+}
+
+
+static uint32_t bitWidth(uint32_t value) {
+	uint32_t width = 0;
+	while (value > 0) {
+		value >>= 1;
+		width++;
+	}
+	return width;
+}
+
+
+static uint32_t delta(Capture* capture, uint32_t column, uint32_t i) {
+	switch (column) {
+		case 0:
+			return zigzag((int32_t) capture->x[i] - capture->x[i - 1]);
+		case 1:
+			return zigzag((int32_t) capture->y[i] - capture->y[i - 1]);
+		case 2:
+			return zigzag((int32_t) capture->z[i] - capture->z[i - 1]);
+		default:
+			return zigzag((int32_t) capture->interval[i] - CAPTURE_INTERVAL_MS);
+	}
+}
+
+
+static void flushBlock(Capture* capture) {
+	if (capture->count == 0)
+		return;
+
+	uint8_t widths[4] = { 0, 0, 0, 0 };
+	for (uint32_t column = 0; column < 4; column++) {
+		for (uint32_t i = 1; i < capture->count; i++) {
+			uint32_t width = bitWidth(delta(capture, column, i));
+			if (width > widths[column])
+				widths[column] = width;
+		}
+	}
+
+	putByte(capture, (uint8_t) capture->count);
+	putByte(capture, capture->label);
+	for (uint32_t i = 0; i < 8; i++) {
+		putByte(capture, (uint8_t) (capture->timestamp >> (i * 8)));
+	}
+	putByte(capture, (uint8_t) capture->x[0]);
+	putByte(capture, (uint8_t) ((uint16_t) capture->x[0] >> 8));
+	putByte(capture, (uint8_t) capture->y[0]);
+	putByte(capture, (uint8_t) ((uint16_t) capture->y[0] >> 8));
+	putByte(capture, (uint8_t) capture->z[0]);
+	putByte(capture, (uint8_t) ((uint16_t) capture->z[0] >> 8));
+	for (uint32_t column = 0; column < 4; column++) {
+		putByte(capture, widths[column]);
+	}
+	for (uint32_t i = 0; i < 4; i++) {
+		putByte(capture, (uint8_t) (capture->vibrate >> (i * 8)));
+	}
+
+	for (uint32_t column = 0; column < 4; column++) {
+		for (uint32_t i = 1; i < capture->count; i++) {
+			putBits(capture, delta(capture, column, i), widths[column]);
+		}
+	}
+	alignBits(capture);
+
+	capture->count = 0;
+	capture->vibrate = 0;
+}
+
+
+void startCapture(Capture* capture) {
+	if (isCapturing(capture))
+		return;
+
+	memset(capture, 0, sizeof(Capture));
+	capture->session = data_logging_create(CAPTURE_DATA_LOG_TAG, DATA_LOGGING_BYTE_ARRAY, CAPTURE_ITEM_SIZE, false);
+
+	// Enough for a host tool to tell the stream apart and lay out its own trace header
+	putBits(capture, CAPTURE_MAGIC, 24);
+	putByte(capture, CAPTURE_VERSION);
+	putByte(capture, 1000 / CAPTURE_INTERVAL_MS);
+	putByte(capture, CAPTURE_BLOCK_SIZE);
+}
+
+
+void stopCapture(Capture* capture) {
+	if (! isCapturing(capture))
+		return;
+
+	flushBlock(capture);
+	// Pad the last item, the zero count tells the decoder where the stream ends
+	if (capture->itemSize > 0) {
+		memset(capture->item + capture->itemSize, 0, CAPTURE_ITEM_SIZE - capture->itemSize);
+		data_logging_log(capture->session, capture->item, 1);
+	}
+	data_logging_finish(capture->session);
+	capture->session = NULL;
+}
+
+
+bool isCapturing(Capture* capture) {
+	return capture->session != NULL;
+}
+
+
+void captureSamples(Capture* capture, AccelData* acceleration, uint32_t size, uint32_t label) {
+	if (! isCapturing(capture))
+		return;
+
+	for (uint32_t i = 0; i < size; i++) {
+		AccelData* sample = &acceleration[i];
+
+		if (capture->count > 0) {
+			uint64_t interval = sample->timestamp - capture->lastTimestamp;
+			// A new block whenever the label changes or the gap does not fit the time column
+			if (capture->count == CAPTURE_BLOCK_SIZE || capture->label != label || interval > UINT16_MAX) {
+				flushBlock(capture);
+			} else {
+				capture->interval[capture->count] = (uint16_t) interval;
+			}
+		}
+
+		if (capture->count == 0) {
+			capture->label = (uint8_t) label;
+			capture->timestamp = sample->timestamp;
+			capture->interval[0] = 0;
+		}
+		capture->x[capture->count] = sample->x;
+		capture->y[capture->count] = sample->y;
+		capture->z[capture->count] = sample->z;
+		capture->lastTimestamp = sample->timestamp;
+		if (sample->did_vibrate)
+			capture->vibrate |= 1 << capture->count;
+		capture->count++;
+	}
+}
@@ -1,11 +1,14 @@
 #include "classifier.h"
+#include "lowpassfilter.h"
 
 
+#if CLASSIFIER_BACKEND == CLASSIFIER_LINEAR
+
 uint32_t classify(Feature feature) {
 	uint32_t type = 0;
 	double probability = 0.0;
 
-	double class0 = 6.95 +
+	double class0 = 6.95 + CLASSIFIER_BIAS(0) +
 		feature.meanV * 0.87 +
 		feature.meanH * -0.26 +
 		feature.deviationV * -0.03 +
@@ -13,7 +16,7 @@ uint32_t classify(Feature feature) {
 	probability = class0;
 	type = 0;
 
-	double class1 = 2.7 +
+	double class1 = 2.7 + CLASSIFIER_BIAS(1) +
 		feature.meanV * 0.05 +
 		feature.meanH * -0.05 +
 		feature.deviationV * 0 +
@@ -23,24 +26,45 @@ uint32_t classify(Feature feature) {
 		type = 1;
 	}
 
-	double class2 = -3.73 +
+	// Walking and jogging have a step rhythm, random arm motion does not. Jogging's is faster: the 2.5 Hz bin
+	// and up (150 steps per minute), where a walk stays at 2 Hz or below.
+	double rhythm = (feature.cadenceStrength - 0.2) * 5.0;
+	double pace = feature.cadenceStrength * (feature.cadence - 2.0);
+
+	double class2 = -3.73 + CLASSIFIER_BIAS(2) +
 		feature.meanV * -0.16 +
 		feature.meanH * 0.1  +
 		feature.deviationV * 0 +
-		feature.deviationH * 0;
+		feature.deviationH * 0 +
+		rhythm;
 	if (class2 > probability) {
 		probability = class2;
 		type = 2;
 	}
 
-	double class3 = -65.76 +
+	double class3 = -65.76 + CLASSIFIER_BIAS(3) +
+		feature.meanV * 0 +
 		feature.meanH * 0.31 +
 		feature.deviationV * 0 +
-		feature.deviationH * 0;
+		feature.deviationH * 0 +
+		rhythm +
+		pace * 100.0;
 	if (class3 > probability) {
 		probability = class3;
 		type = 3;
 	}
 
+	// Driving: steady vibration with no step rhythm. Weights fitted on synthetic traces with evaluate.
+	double class4 = -1.0 + CLASSIFIER_BIAS(4) +
+		clamp(feature.energyHF, 0.0, 100.0) * 0.1 +
+		feature.periodicity * -10.0 +
+		feature.cadenceStrength * -10.0;
+	if (class4 > probability) {
+		probability = class4;
+		type = 4;
+	}
+
 	return type;
 }
+
+#endif
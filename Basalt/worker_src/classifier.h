@@ -3,11 +3,27 @@
 
 #include <pebble_worker.h>
 
+// Classifier backend, fixed at build time with the wscript's --classifier option. Both implement classify().
+#define CLASSIFIER_LINEAR	0	// Hand-tuned linear score per type, classifier.c
+#define CLASSIFIER_FOREST	1	// Quantized int8 decision forest, forest.c
+#ifndef CLASSIFIER_BACKEND
+#define CLASSIFIER_BACKEND	CLASSIFIER_LINEAR
+#endif
+
+// Extra score per type on top of the linear model's intercepts, for host sweeps. Nothing on the watch.
+#ifndef CLASSIFIER_BIAS
+#define CLASSIFIER_BIAS(type)	0
+#endif
+
 typedef struct {
 	double meanH;
 	double meanV;
 	double deviationH;
 	double deviationV;
+	double energyHF;	// Mean squared sample-to-sample change of the vertical component
+	double periodicity;	// Peak autocorrelation of the vertical component at step cadence, [0, 1]
+	double cadence;	// Dominant frequency of the vertical component in the step range, Hz
+	double cadenceStrength;	// Share of the vertical energy at that frequency, [0, 1]
 } Feature;
 
 
@@ -0,0 +1,39 @@
+#ifndef _FOREST_H_
+#define _FOREST_H_
+
+#include <pebble_worker.h>
+#include "classifier.h"
+
+/*
+ * Decision forest over the window's features, quantized to int8: the means in mG (meanH in 2 mG steps),
+ * the second moments in quarter steps of log2, periodicity and cadence strength in percent and the cadence
+ * in half hertz. The trees and the quantization never touch floating point after the features are
+ * converted. The tables are const, but the watch loads the whole worker binary into RAM, const data
+ * included, so the 75 nodes (300 bytes) and the roots count against the worker's RAM budget like code.
+ */
+#define FOREST_FEATURES	8
+#define FOREST_LEAF		0xFF	// Node feature of a leaf
+
+enum {
+	FOREST_MEAN_V = 0,
+	FOREST_MEAN_H,
+	FOREST_DEVIATION_V,
+	FOREST_DEVIATION_H,
+	FOREST_ENERGY_HF,
+	FOREST_PERIODICITY,
+	FOREST_CADENCE,
+	FOREST_CADENCE_STRENGTH
+};
+
+// 4 bytes. An inner node goes left when its feature is at or below the threshold. A leaf votes for the
+// type in left with the weight in threshold.
+typedef struct {
+	uint8_t feature;
+	int8_t threshold;
+	uint8_t left;
+	uint8_t right;
+} ForestNode;
+
+void quantizeFeature(Feature* feature, int8_t* quantized);
+
+#endif
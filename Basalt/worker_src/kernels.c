@@ -0,0 +1,84 @@
+#include "kernels.h"
+
+#ifdef DSP_KERNELS
+// The instructions are written out because the SDK's compiler predates the ACLE SIMD intrinsics
+
+// accumulator + a.lo * b.lo + a.hi * b.hi
+static inline int32_t smlad(uint32_t a, uint32_t b, int32_t accumulator) {
+	int32_t result;
+	__asm__ ("smlad %0, %1, %2, %3" : "=r" (result) : "r" (a), "r" (b), "r" (accumulator));
+	return result;
+}
+
+
+// Same with a 64-bit accumulator
+static inline int64_t smlald(uint32_t a, uint32_t b, int64_t accumulator) {
+	__asm__ ("smlald %Q0, %R0, %1, %2" : "+r" (accumulator) : "r" (a), "r" (b));
+	return accumulator;
+}
+
+
+// Low halves of a and b, as (a.lo, b.lo)
+static inline uint32_t packLow(uint32_t a, uint32_t b) {
+	uint32_t result;
+	__asm__ ("pkhbt %0, %1, %2, lsl #16" : "=r" (result) : "r" (a), "r" (b));
+	return result;
+}
+
+
+// High halves of a and b, as (a.hi, b.hi)
+static inline uint32_t packHigh(uint32_t a, uint32_t b) {
+	uint32_t result;
+	__asm__ ("pkhtb %0, %2, %1, asr #16" : "=r" (result) : "r" (a), "r" (b));
+	return result;
+}
+
+
+static inline uint32_t pack(int16_t lo, int16_t hi) {
+	return (uint16_t) lo | ((uint32_t) (uint16_t) hi << 16);
+}
+#endif
+
+
+// a . b for 3D vectors, exact as long as it fits in 32 bits (it does for accelerometer values)
+int32_t dotProduct(int16_t ax, int16_t ay, int16_t az, int16_t bx, int16_t by, int16_t bz) {
+#ifdef DSP_KERNELS
+	return smlad(pack(ax, ay), pack(bx, by), (int32_t) az * bz);
+#else
+	return (int32_t) ax * bx + (int32_t) ay * by + (int32_t) az * bz;
+#endif
+}
+
+
+// Sums and sums of squares of v and h over the window
+void sumMoments(const Projection* window, uint32_t size, Moments* moments) {
+	int32_t sumV = 0, sumH = 0;
+	int64_t squaresV = 0, squaresH = 0;
+	uint32_t i = 0;
+
+#ifdef DSP_KERNELS
+	// Two samples per iteration: regroup (v0, h0), (v1, h1) into (v0, v1) and (h0, h1)
+	const uint32_t ones = 0x00010001;
+	for (; i + 1 < size; i += 2) {
+		uint32_t first = window[i].word;
+		uint32_t second = window[i + 1].word;
+		uint32_t v = packLow(first, second);
+		uint32_t h = packHigh(first, second);
+		sumV = smlad(v, ones, sumV);
+		sumH = smlad(h, ones, sumH);
+		squaresV = smlald(v, v, squaresV);
+		squaresH = smlald(h, h, squaresH);
+	}
+#endif
+	for (; i < size; i++) {
+		sumV += window[i].v;
+		sumH += window[i].h;
+		squaresV += (int32_t) window[i].v * window[i].v;
+		squaresH += (int32_t) window[i].h * window[i].h;
+	}
+
+	moments->sumV = sumV;
+	moments->sumH = sumH;
+	moments->squaresV = squaresV;
+	moments->squaresH = squaresH;
+}
@@ -0,0 +1,35 @@
+#ifndef _KERNELS_H_
+#define _KERNELS_H_
+
+#include <pebble_worker.h>
+
+// Every build runs the plain C loops, which tools/tests/kernels_check.c holds to the old double sums.
+// Building with -DDSP_KERNELS for a Cortex-M4 (wscript --dsp-kernels) packs two int16 values per word and
+// uses the dual 16-bit MAC instructions instead. That path is written to give the same results but has not
+// been run on hardware or under QEMU yet, so it stays opt-in.
+#if defined(DSP_KERNELS) && ! defined(__ARM_FEATURE_DSP) && ! defined(__ARM_ARCH_7EM__)
+#error "DSP_KERNELS needs a Cortex-M4 target, -mcpu=cortex-m4"
+#endif
+
+// Linear acceleration of one sample, along (v) and across (h) the gravity direction.
+// v is the low half of the word and h the high half; the word is how the DSP kernels read the pair.
+typedef union {
+	struct {
+		int16_t v;
+		int16_t h;
+	};
+	uint32_t word;
+} Projection;
+
+// Integer moments of a window of projections
+typedef struct {
+	int32_t sumV;
+	int32_t sumH;
+	int64_t squaresV;
+	int64_t squaresH;
+} Moments;
+
+int32_t dotProduct(int16_t ax, int16_t ay, int16_t az, int16_t bx, int16_t by, int16_t bz);
+void sumMoments(const Projection* window, uint32_t size, Moments* moments);
+
+#endif
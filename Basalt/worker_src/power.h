@@ -0,0 +1,46 @@
+#ifndef _POWER_H_
+#define _POWER_H_
+
+#include <pebble_worker.h>
+#include "sampling.h"
+
+#define POWER_NO_OVERLAP_PERCENT	40	// At or below: windows stop overlapping
+#define POWER_MOTION_GATED_PERCENT	20	// At or below: still batches skip the recognizer
+#define POWER_SUSPEND_PERCENT		10	// At or below: accelerometer off, a tap turns it on for a while
+#define POWER_HYSTERESIS_PERCENT	10	// Charge has to climb this far above a threshold to go back up a tier
+#define POWER_MOTION_THRESHOLD		30	// mG, mean deviation of a batch's magnitude from its mean
+#define POWER_STILL_BATCHES			(SAMPLE_SIZE / BATCH_SIZE)	// Still batches before the gate closes, a whole window: they do not overlap here
+#define POWER_WAKE_S				300	// Sampling after a tap while suspended
+
+/*
+ * Degradation tiers, cheapest last. Work per hour at the default 10 Hz, 8 s profile, measured with
+ * tools/longrun -d 7 -k 0 -j 0 -b <charge> from the profiler counters, nights included (night mode skips
+ * the recognizer, so the awake ceilings are 900 and 450 windows). Host CPU per day only ranks the tiers.
+ *   POWER_FULL          36000 samples, 408 windows, 91 ms: every sample is classified twice
+ *   POWER_NO_OVERLAP    36000 samples, 217 windows, 88 ms: windows hop their whole length
+ *   POWER_MOTION_GATED  36000 samples, 175 windows, 1820 of 3600 batches gated, 77 ms: one pass of squared
+ *                       magnitudes per batch, windows only while moving
+ *   POWER_SUSPENDED     no samples, 60 suspended minutes, 19 ms; a tap samples at POWER_MOTION_GATED for
+ *                       POWER_WAKE_S (longrun has no taps)
+ * Still time in the gated tier keeps the last still label, sleep or sit, and each window's worth of it counts
+ * towards night mode like a classified window. Suspended time is not counted at all.
+ */
+enum {
+	POWER_FULL = 0,
+	POWER_NO_OVERLAP,
+	POWER_MOTION_GATED,
+	POWER_SUSPENDED,
+	POWER_TIERS
+};
+
+typedef struct {
+	uint32_t tier;
+	uint32_t stillBatches;	// Consecutive batches under the motion threshold
+	uint32_t wakeUntil;	// While suspended, sample until then after a tap
+} Power;
+
+void initPower(Power* power);
+uint32_t choosePowerTier(uint32_t tier, BatteryChargeState state);
+bool gateMotion(Power* power, AccelData* acceleration, uint32_t size);
+
+#endif
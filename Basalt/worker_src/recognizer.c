@@ -1,86 +1,316 @@
 #include "recognizer.h"
 
-// Acceleration
-static uint32_t mDataSize = 0;
-static AccelData mAcceleration[SAMPLE_SIZE];
+void initRecognizer(Recognizer* recognizer) {
+	initLowPassFilter(&recognizer->filter);
+	clearWindow(recognizer);
+	recognizer->rawType = 1;
+	recognizer->overlap = true;
+	recognizer->sink = NULL;
+}
+
+
+static inline void emit(Recognizer* recognizer, uint16_t id, int32_t arg0, int32_t arg1) {
+	if (recognizer->sink != NULL)
+		recognizer->sink(id, arg0, arg1);
+}
+
+
+// Drop a partly filled window, e.g. after the samples stopped coming for a while, and forget the label history.
+// The gravity estimate may be stale as well, so the next batch seeds it again.
+void clearWindow(Recognizer* recognizer) {
+	recognizer->dataSize = 0;
+	recognizer->filter.seeded = false;
+	memset(recognizer->cost, 0, sizeof(recognizer->cost));
+}
+
+
+// Without overlap every sample is classified once instead of twice, and the labels come half as often
+void setOverlap(Recognizer* recognizer, bool overlap) {
+	recognizer->overlap = overlap;
+}
+
+
+// Seconds from one window to the next, the time the steps of a window stand for
+uint32_t windowHop(Recognizer* recognizer) {
+	return recognizer->overlap ? SAMPLE_INTERVAL_S / 2 : SAMPLE_INTERVAL_S;
+}
+
+
+void saveRecognizer(Recognizer* recognizer, uint32_t currentType, RecognizerState* state) {
+	state->x = recognizer->filter.x;
+	state->y = recognizer->filter.y;
+	state->z = recognizer->filter.z;
+	state->type = (uint16_t) currentType;
+}
+
+
+// Pick up where the last run stopped: its gravity estimate, and its label as the one to beat
+void restoreRecognizer(Recognizer* recognizer, uint32_t* currentType, RecognizerState* state) {
+	restoreLowPassFilter(&recognizer->filter, state->x, state->y, state->z);
+	if (state->type < ACTIVITY_TYPES) {
+		*currentType = state->type;
+		recognizer->rawType = state->type;
+		for (uint32_t type = 0; type < ACTIVITY_TYPES; type++) {
+			recognizer->cost[type] = type == state->type ? 0 : SMOOTHING_SWITCH_COST;
+		}
+	}
+}
+
+
+// Online min-cost forward filter over the activity types with fixed costs, in integers
+uint32_t smoothType(Recognizer* recognizer, uint32_t observed) {
+	uint16_t* cost = recognizer->cost;
+
+	// Cheapest way to have been anywhere, switching from there costs the same for every type
+	uint16_t cheapest = cost[0];
+	for (uint32_t type = 1; type < ACTIVITY_TYPES; type++) {
+		if (cost[type] < cheapest)
+			cheapest = cost[type];
+	}
+
+	uint32_t best = observed;
+	uint16_t bestCost = UINT16_MAX;
+	for (uint32_t type = 0; type < ACTIVITY_TYPES; type++) {
+		uint16_t stay = cost[type] + SMOOTHING_STAY_COST;
+		uint16_t move = cheapest + SMOOTHING_SWITCH_COST;
+		cost[type] = (stay < move ? stay : move) + (type == observed ? SMOOTHING_MATCH_COST : SMOOTHING_MISMATCH_COST);
+		if (cost[type] < bestCost) {
+			bestCost = cost[type];
+			best = type;
+		}
+	}
+
+	// Keep the costs small, only their differences matter
+	for (uint32_t type = 0; type < ACTIVITY_TYPES; type++) {
+		cost[type] -= bestCost;
+	}
+	return best;
+}
+
+
+// Filter one sample and keep only its projection on the gravity direction
+static void projectSample(Recognizer* recognizer, AccelData* sample) {
+	LowPassFilter* filter = &recognizer->filter;
+
+	// Filter out the gravity vector
+	goThroughFilter(filter, sample->x, sample->y, sample->z);
+	// Convert to linear acceleration
+	int16_t x = sample->x - filter->x;
+	int16_t y = sample->y - filter->y;
+	int16_t z = sample->z - filter->z;
+
+	// Project 3D acceleration vector to gravity direction
+	double v = (double) dotProduct(x, y, z, filter->x, filter->y, filter->z) / (double) norm(filter->x, filter->y, filter->z);
+	double h = (double) wdSqrt((uint32_t) ((double) dotProduct(x, y, z, x, y, z) - v * v));
+
+	recognizer->window[recognizer->dataSize].v = (int16_t) v;
+	recognizer->window[recognizer->dataSize].h = (int16_t) h;
+	recognizer->dataSize++;
+}
+
+
+// Strongest normalized autocorrelation of the projected vertical component over step cadence lags. The sums
+// are int32: deviations from the mean are shifted right until a whole window of their products fits.
+static double findPeriodicity(Recognizer* recognizer, double mean) {
+	Projection* window = recognizer->window;
+	int32_t center = (int32_t) (mean < 0.0 ? mean - 0.5 : mean + 0.5);
+
+	uint32_t largest = 0;
+	for (uint32_t i = 0; i < SAMPLE_SIZE; i++) {
+		uint32_t deviation = (uint32_t) abs(window[i].v - center);
+		if (deviation > largest)
+			largest = deviation;
+	}
+	uint32_t shift = 0;
+	while ((largest >> shift) * (largest >> shift) > (uint32_t) INT32_MAX / SAMPLE_SIZE)
+		shift++;
+
+	int32_t variance = 0;
+	for (uint32_t i = 0; i < SAMPLE_SIZE; i++) {
+		int32_t deviation = (window[i].v - center) >> shift;
+		variance += deviation * deviation;
+	}
+	if (variance <= 0)
+		return 0.0;
+
+	int64_t periodicity = 0;
+	for (uint32_t lag = MIN_STEP_LAG; lag <= MAX_STEP_LAG; lag++) {
+		int32_t correlation = 0;
+		for (uint32_t i = 0; i + lag < SAMPLE_SIZE; i++) {
+			correlation += ((window[i].v - center) >> shift) * ((window[i + lag].v - center) >> shift);
+		}
+		// Rescale for the shorter overlap
+		int64_t rescaled = (int64_t) correlation * SAMPLE_SIZE / (SAMPLE_SIZE - lag);
+		if (rescaled > periodicity)
+			periodicity = rescaled;
+	}
+
+	return clamp((double) periodicity / variance, 0.0, 1.0);
+}
+
+
+// Power of one Goertzel bin at the end of a block, exact in 64 bits
+static inline int64_t goertzelPower(int32_t coefficient, int32_t s1, int32_t s2) {
+	return (int64_t) s1 * s1 + (int64_t) s2 * s2 - (((int64_t) coefficient * s1 * s2) >> 16);
+}
+
+
+// Strongest cadence bin and its share of the window's energy, the only conversion to double
+static void findCadence(Feature* feature, int64_t* power, double energy) {
+	feature->cadence = 0.0, feature->cadenceStrength = 0.0;
+	if (energy <= 0.0)
+		return;
+
+	int64_t strongest = 0;
+	for (uint32_t bin = 0; bin < CADENCE_BINS; bin++) {
+		if (power[bin] > strongest) {
+			strongest = power[bin];
+			feature->cadence = (CADENCE_FIRST_BIN + bin) / 2.0;
+		}
+	}
+
+	// A pure tone in one bin has a power of block size / 2 times its energy
+	feature->cadenceStrength = clamp((double) strongest / (CADENCE_BLOCK_SIZE / 2.0 * energy), 0.0, 1.0);
+}
+
+
+// Front half of a window: describe the projected samples. None of it depends on the user settings.
+void extractFeature(Recognizer* recognizer, Feature* feature) {
+	Projection* window = recognizer->window;
+
+	// Integer sums are exact, so they match the old double accumulation bit for bit
+	Moments moments;
+	sumMoments(window, SAMPLE_SIZE, &moments);
+	feature->meanV = moments.sumV, feature->meanH = moments.sumH;
+	feature->deviationV = moments.squaresV, feature->deviationH = moments.squaresH;
+
+	// Goertzel bank, 2 cos(w) with 16 fractional bits
+	int32_t coefficients[CADENCE_BINS];
+	int32_t s1[CADENCE_BINS];
+	int32_t s2[CADENCE_BINS];
+	int64_t power[CADENCE_BINS];
+	for (uint32_t bin = 0; bin < CADENCE_BINS; bin++) {
+		coefficients[bin] = 2 * cos_lookup(TRIG_MAX_ANGLE * (CADENCE_FIRST_BIN + bin) / (2 * SAMPLE_RATE_HZ));
+		s1[bin] = 0;
+		s2[bin] = 0;
+		power[bin] = 0;
+	}
+
+	recognizer->maxV = -32767;	// Actually, it should be -32768. I just hate asymmetry...
+	recognizer->minV = 32767;
+	feature->energyHF = 0.0, feature->periodicity = 0.0;
+	for (uint32_t i = 0; i < SAMPLE_SIZE; i++) {
+		double v = window[i].v;
+
+		if (i > 0)
+			feature->energyHF += (v - window[i - 1].v) * (v - window[i - 1].v);
+
+		for (uint32_t bin = 0; bin < CADENCE_BINS; bin++) {
+			int32_t s = window[i].v + (int32_t) (((int64_t) coefficients[bin] * s1[bin]) >> 16) - s2[bin];
+			s2[bin] = s1[bin];
+			s1[bin] = s;
+		}
+		if ((i + 1) % CADENCE_BLOCK_SIZE == 0) {
+			for (uint32_t bin = 0; bin < CADENCE_BINS; bin++) {
+				power[bin] += goertzelPower(coefficients[bin], s1[bin], s2[bin]);
+				s1[bin] = 0;
+				s2[bin] = 0;
+			}
+		}
+
+		if (window[i].v > recognizer->maxV)
+			recognizer->maxV = window[i].v;
+		if (window[i].v < recognizer->minV)
+			recognizer->minV = window[i].v;
+	}
+
+	feature->meanV /= (recognizer->dataSize - 1);
+	feature->meanH /= (recognizer->dataSize - 1);
+	feature->deviationV = feature->deviationV / (recognizer->dataSize - 1) - feature->meanV * feature->meanV;
+	feature->deviationH = feature->deviationH / (recognizer->dataSize - 1) - feature->meanH * feature->meanH;
+	feature->energyHF = feature->energyHF / (recognizer->dataSize - 1) * ENERGY_HF_SCALE;
+	feature->periodicity = findPeriodicity(recognizer, feature->meanV);
+	findCadence(feature, power, (double) moments.squaresV - (double) moments.sumV * moments.sumV / SAMPLE_SIZE);
+}
+
+
+// Back half of a window: count the steps of a walking or jogging window. A step is two crossings; with
+// overlap every sample is in two windows, so each window only gets half of its steps.
+uint32_t countSteps(Recognizer* recognizer, Feature* feature, uint32_t type, int32_t sensitivity) {
+	Projection* window = recognizer->window;
+	uint32_t steps = 0;
+	int direction = 0;
+
+	double ratio = 0.0;
+	if (type == 2) {	// Only filer steps for walking, but NOT for jogging!
+		ratio = (double) sensitivity / 100.0;
+	}
+
+	for (uint32_t i = 0; i < SAMPLE_SIZE; i++) {
+		if (window[i].v > feature->meanV + (recognizer->maxV - feature->meanV) * ratio) {
+			if (direction == -1)
+				steps++;
+			direction = 1;
+		} else if (window[i].v < feature->meanV + (recognizer->minV - feature->meanV) * ratio) {
+			if (direction == 1)
+				steps++;
+			direction = -1;
+		}
+	}
+
+	return recognizer->overlap ? steps / 4 : steps / 2;
+}
 
 
 // Handle accleration data
-uint32_t analyzeAcceleration(uint32_t* currentType, Counter* counter, LowPassFilter* filter, int32_t sensitivity, AccelData* acceleration, uint32_t size) {
+uint32_t analyzeAcceleration(Recognizer* recognizer, uint32_t* currentType, Counter* counter, uint32_t timestamp, int32_t sensitivity, AccelData* acceleration, uint32_t size) {
 	// I don't know if Pebble's API will fail to return 0 sample. Just in case.
 	if (size == 0) {
-		APP_LOG(APP_LOG_LEVEL_INFO, "No acceleration sample!!");
+		LOG(APP_LOG_LEVEL_WARNING, "No acceleration sample!!");
 		return 1;
 	} else {
-		// Add samples
-		uint32_t i = 0;
-		for (; i < size && mDataSize + i < SAMPLE_SIZE; i++) {
-			mAcceleration[mDataSize + i].x = acceleration[i].x;
-			mAcceleration[mDataSize + i].y = acceleration[i].y;
-			mAcceleration[mDataSize + i].z = acceleration[i].z;
+		if (!recognizer->filter.seeded) {
+			uint32_t distance;
+			bool kept = seedLowPassFilter(&recognizer->filter, acceleration, size, &distance);
+			emit(recognizer, TRACE_FILTER_SEED, (int32_t) distance, kept);
+		}
+
+		// Add samples straight from the service's buffer
+		for (uint32_t i = 0; i < size && recognizer->dataSize < SAMPLE_SIZE; i++) {
+			projectSample(recognizer, &acceleration[i]);
 		}
-		mDataSize += i;
 	}
 
 	// Check if enough
-	if (mDataSize < SAMPLE_SIZE) {	// Not enough, so add data to collection first
-		APP_LOG(APP_LOG_LEVEL_INFO, "Sample collector: %d/%d", (int) mDataSize, SAMPLE_SIZE);
+	if (recognizer->dataSize < SAMPLE_SIZE) {	// Not enough, so add data to collection first
+		LOG(APP_LOG_LEVEL_DEBUG, "Sample collector: %d/%d", (int) recognizer->dataSize, SAMPLE_SIZE);
 		return 2;
 	} else {	// Enough for classification
-		int16_t maxV = -32767;	// Actually, it should be -32768. I just hate asymmetry...
-		int16_t minV = 32767;
 		Feature feature;
-		feature.meanV = 0.0, feature.meanH = 0.0, feature.deviationV = 0.0, feature.deviationH = 0.0;
-		for (uint32_t i = 0; i < SAMPLE_SIZE; i++) {
-			// Filter out the gravity vector
-			goThroughFilter(filter, mAcceleration[i].x, mAcceleration[i].y, mAcceleration[i].z);
-			// Convert to linear acceleration
-			mAcceleration[i].x = mAcceleration[i].x - filter->x;
-			mAcceleration[i].y = mAcceleration[i].y - filter->y;
-			mAcceleration[i].z = mAcceleration[i].z - filter->z;
-
-			// Project 3D acceleration vector to gravity direction
-			double v = ((double) mAcceleration[i].x * (double) filter->x
-					+ (double) mAcceleration[i].y * (double) filter->y
-					+ (double) mAcceleration[i].z * (double) filter->z) / (double) norm((int16_t) filter->x, (int16_t) filter->y, (int16_t) filter->z);
-			double h = (double) wdSqrt((uint32_t)
-					((double) mAcceleration[i].x * (double) mAcceleration[i].x
-					+ (double) mAcceleration[i].y * (double) mAcceleration[i].y
-					+ (double) mAcceleration[i].z * (double) mAcceleration[i].z - v * v));
-
-			feature.meanV += v;
-			feature.meanH += h;
-			feature.deviationV += v * v;
-			feature.deviationH += h * h;
-
-			// Reuse it for later step counter
-			mAcceleration[i].x = v;
-			mAcceleration[i].y = h;
-			if (mAcceleration[i].x > maxV)
-				maxV = mAcceleration[i].x;
-			if (mAcceleration[i].x < minV)
-				minV = mAcceleration[i].x;
-		}
-
-		feature.meanV /= (mDataSize - 1);
-		feature.meanH /= (mDataSize - 1);
-		feature.deviationV = feature.deviationV / (mDataSize - 1) - feature.meanV * feature.meanV;
-		feature.deviationH = feature.deviationH / (mDataSize - 1) - feature.meanH * feature.meanH;
+		extractFeature(recognizer, &feature);
 
-		// Classification
-		*currentType = classify(feature);
+		// Classification, smoothed over the previous windows
+		recognizer->rawType = classify(feature);
+		*currentType = smoothType(recognizer, recognizer->rawType);
 
-		APP_LOG(APP_LOG_LEVEL_INFO, "%d %d %d %d: %d", (int) feature.meanV, (int) feature.meanH, (int) feature.deviationV, (int) feature.deviationH, (int) *currentType);
+		LOG(APP_LOG_LEVEL_DEBUG, "%d %d %d %d %d %d: %d", (int) feature.meanV, (int) feature.meanH, (int) feature.deviationV, (int) feature.deviationH, (int) feature.energyHF, (int) (feature.periodicity * 100), (int) *currentType);
+#ifdef TRACE_FEATURES
+		emit(recognizer, TRACE_SMOOTHING, (int32_t) recognizer->rawType, (int32_t) *currentType);
+		emit(recognizer, TRACE_FEATURE_MEAN, (int32_t) feature.meanV, (int32_t) feature.meanH);
+		emit(recognizer, TRACE_FEATURE_DEVIATION, (int32_t) feature.deviationV, (int32_t) feature.deviationH);
+		emit(recognizer, TRACE_FEATURE_RHYTHM, (int32_t) feature.energyHF, (int32_t) (feature.periodicity * 100));
+		emit(recognizer, TRACE_FEATURE_CADENCE, (int32_t) (feature.cadence * 100), (int32_t) (feature.cadenceStrength * 100));
+#endif
 
 		// Update
-		uint32_t timestamp = (uint32_t) time(NULL);
-		uint32_t elapsedTime = timestamp - counter->timestamp;
+		uint32_t elapsedTime = elapsedSince(counter, timestamp);
 
 		switch(*currentType) {
 			case 0:
 				counter->sleepTime += elapsedTime;
 				break;
 			case 1:
+			case 4:	// Driving counts as sitting
 				counter->sitTime += elapsedTime;
 				break;
 			case 2:
@@ -94,30 +324,14 @@ uint32_t analyzeAcceleration(uint32_t* currentType, Counter* counter, LowPassFil
 
 		// Count steps
 		uint32_t steps = 0;
-		if (*currentType > 1) {	// Walking or Jogging
-			int direction = 0;
-
-			double ratio = 0.0;
-			if (*currentType == 2) {	// Only filer steps for walking, but NOT for jogging!
-				ratio = (double) sensitivity / 100.0;
-			}
-
-			for (uint32_t i = 0; i < SAMPLE_SIZE; i++) {
-				if (mAcceleration[i].x > feature.meanV + (maxV - feature.meanV) * ratio) {
-					if (direction == -1)
-						steps++;
-					direction = 1;
-				} else if (mAcceleration[i].x < feature.meanV + (minV - feature.meanV) * ratio) {
-					if (direction == 1)
-						steps++;
-					direction = -1;
-				}
-			}
-			steps /= 4;
+		if (*currentType == 2 || *currentType == 3) {	// Walking or Jogging
+			steps = countSteps(recognizer, &feature, *currentType, sensitivity);
 
 			if (*currentType == 2) {
-				if (steps > elapsedTime * MAX_WALKING_SPEED) {	// Driving may be recognized as walking. Fix it.
-					*currentType = 1;
+				// Driving may be recognized as walking: too many steps, or a clear rhythm faster than anyone walks. Fix it.
+				bool vibrating = feature.cadenceStrength >= CADENCE_MIN_STRENGTH && feature.cadence > MAX_WALKING_SPEED;
+				if (steps > windowHop(recognizer) * MAX_WALKING_SPEED || vibrating) {
+					*currentType = 4;
 					counter->sitTime += elapsedTime;
 					counter->walkTime -= elapsedTime;
 					steps = 0;
@@ -126,15 +340,20 @@ uint32_t analyzeAcceleration(uint32_t* currentType, Counter* counter, LowPassFil
 
 			counter->steps += steps;
 		}
+		uint32_t elapsed = elapsedTime > UINT16_MAX ? UINT16_MAX : elapsedTime;
+		emit(recognizer, TRACE_CLASS, (int32_t) (*currentType | recognizer->rawType << 8 | elapsed << 16), (int32_t) steps);
+#ifdef TRACE_FEATURES
+		emit(recognizer, TRACE_STEPS, (int32_t) steps, (int32_t) counter->steps);
+#endif
 		
 		// Clean up for next round
-		// Sliding window: move the latter half to the front
-		for (uint32_t i = 0; i < SAMPLE_SIZE / 2; i++) {
-			mAcceleration[i].x = mAcceleration[SAMPLE_SIZE / 2 + i].x;
-			mAcceleration[i].y = mAcceleration[SAMPLE_SIZE / 2 + i].y;
-			mAcceleration[i].z = mAcceleration[SAMPLE_SIZE / 2 + i].z;
+		// Sliding window: move the latter half to the front, or start over when windows do not overlap
+		if (recognizer->overlap) {
+			memcpy(recognizer->window, recognizer->window + SAMPLE_SIZE / 2, sizeof(Projection) * SAMPLE_SIZE / 2);
+			recognizer->dataSize = SAMPLE_SIZE / 2;
+		} else {
+			recognizer->dataSize = 0;
 		}
-		mDataSize = SAMPLE_SIZE / 2;
 		return 0;
 	}
 }
@@ -0,0 +1,93 @@
+#include "rollup.h"
+
+#define HOUR_S	3600
+
+void initRollup(Rollup* rollup, uint32_t now) {
+	memset(rollup, 0, sizeof(Rollup));
+	rollup->hourEnd = now - now % HOUR_S + HOUR_S;
+}
+
+
+static void setHourMinutes(Rollup* rollup, uint32_t slot, uint32_t type, uint32_t minutes) {
+	uint8_t* packed = rollup->hourMinutes[slot];
+	uint32_t bits = packed[0] | (packed[1] << 8) | (packed[2] << 16);
+	bits = (bits & ~(0x3F << (type * 6))) | ((minutes > 0x3F ? 0x3F : minutes) << (type * 6));
+	packed[0] = bits & 0xFF;
+	packed[1] = (bits >> 8) & 0xFF;
+	packed[2] = (bits >> 16) & 0xFF;
+}
+
+
+static uint16_t addSaturated(uint16_t total, uint32_t amount) {
+	return total + amount > UINT16_MAX ? UINT16_MAX : total + amount;
+}
+
+
+// Counters go back to zero at the daily reset, which is not time spent
+static uint32_t difference(uint32_t before, uint32_t after) {
+	return after >= before ? after - before : 0;
+}
+
+
+// Move to the hour that contains now, clearing the hours nobody was around for
+static void rotateHours(Rollup* rollup, uint32_t now) {
+	for (uint32_t i = 0; i < ROLLUP_HOURS && now >= rollup->hourEnd; i++) {
+		rollup->hourSlot = (rollup->hourSlot + 1) % ROLLUP_HOURS;
+		rollup->hourSteps[rollup->hourSlot] = 0;
+		memset(rollup->hourMinutes[rollup->hourSlot], 0, sizeof(rollup->hourMinutes[0]));
+		rollup->hourEnd += HOUR_S;
+	}
+	// Gone for a day or more: everything is cleared, just catch up
+	if (now >= rollup->hourEnd)
+		rollup->hourEnd = now - now % HOUR_S + HOUR_S;
+}
+
+
+static void addTime(Rollup* rollup, uint32_t type, uint32_t seconds) {
+	seconds += rollup->seconds[type];
+	rollup->seconds[type] = seconds % 60;
+	uint32_t minutes = seconds / 60;
+	if (minutes == 0)
+		return;
+
+	setHourMinutes(rollup, rollup->hourSlot, type, getHourMinutes(rollup, rollup->hourSlot, type) + minutes);
+	rollup->dayMinutes[rollup->daySlot][type] = addSaturated(rollup->dayMinutes[rollup->daySlot][type], minutes);
+	rollup->weekMinutes[rollup->weekSlot][type] = addSaturated(rollup->weekMinutes[rollup->weekSlot][type], minutes);
+}
+
+
+// What the counter gained since previous goes into the current hour, day and week
+void addToRollup(Rollup* rollup, uint32_t now, Counter* previous, Counter* current) {
+	rotateHours(rollup, now);
+
+	addTime(rollup, 0, difference(previous->sleepTime, current->sleepTime));
+	addTime(rollup, 1, difference(previous->sitTime, current->sitTime));
+	addTime(rollup, 2, difference(previous->walkTime, current->walkTime));
+	addTime(rollup, 3, difference(previous->jogTime, current->jogTime));
+
+	uint32_t steps = difference(previous->steps, current->steps);
+	rollup->hourSteps[rollup->hourSlot] = addSaturated(rollup->hourSteps[rollup->hourSlot], steps);
+	rollup->daySteps[rollup->daySlot] = addSaturated(rollup->daySteps[rollup->daySlot], steps);
+	rollup->weekSteps[rollup->weekSlot] += steps;
+}
+
+
+// Called at the daily reset, with the number of resets since the last call and the weekday (0 is Sunday) of the
+// day that starts now. A week starts with the first day on a Monday.
+void closeRollupDays(Rollup* rollup, uint32_t days, uint32_t weekday) {
+	// Beyond this every bucket is cleared anyway
+	uint32_t skipped = days > ROLLUP_DAYS * ROLLUP_WEEKS ? days - ROLLUP_DAYS * ROLLUP_WEEKS : 0;
+
+	for (uint32_t day = skipped + 1; day <= days; day++) {
+		rollup->daySlot = (rollup->daySlot + 1) % ROLLUP_DAYS;
+		rollup->daySteps[rollup->daySlot] = 0;
+		memset(rollup->dayMinutes[rollup->daySlot], 0, sizeof(rollup->dayMinutes[0]));
+
+		// Weekday of this day, counting back from the last one
+		if ((weekday + 7 - (days - day) % 7) % 7 == 1) {
+			rollup->weekSlot = (rollup->weekSlot + 1) % ROLLUP_WEEKS;
+			rollup->weekSteps[rollup->weekSlot] = 0;
+			memset(rollup->weekMinutes[rollup->weekSlot], 0, sizeof(rollup->weekMinutes[0]));
+		}
+	}
+}
@@ -0,0 +1,59 @@
+#ifndef _SAMPLING_H_
+#define _SAMPLING_H_
+
+#include <pebble_worker.h>
+
+/*
+ * Sampling profile, fixed at build time: SAMPLE_RATE_HZ is 10, 25 or 50 and SAMPLE_INTERVAL_S (the window
+ * length) is 4, 8 or 16. Pick one with the wscript's --sampling option, e.g. --sampling=25:8. Everything
+ * below is a compile-time constant, so every window loop has a fixed trip count for its profile.
+ * Thresholds elsewhere were tuned at 10 Hz and are scaled from there.
+ */
+#ifndef SAMPLE_RATE_HZ
+#define SAMPLE_RATE_HZ		10
+#endif
+#ifndef SAMPLE_INTERVAL_S
+#define SAMPLE_INTERVAL_S	8
+#endif
+
+#if SAMPLE_RATE_HZ == 10
+#define ACCEL_SAMPLING_RATE	ACCEL_SAMPLING_10HZ
+#define BATCH_SIZE			10
+#elif SAMPLE_RATE_HZ == 25
+#define ACCEL_SAMPLING_RATE	ACCEL_SAMPLING_25HZ
+#define BATCH_SIZE			25
+#elif SAMPLE_RATE_HZ == 50
+#define ACCEL_SAMPLING_RATE	ACCEL_SAMPLING_50HZ
+#define BATCH_SIZE			25	// The accelerometer service delivers at most 25 samples per update
+#else
+#error "SAMPLE_RATE_HZ must be 10, 25 or 50"
+#endif
+
+#if SAMPLE_INTERVAL_S != 4 && SAMPLE_INTERVAL_S != 8 && SAMPLE_INTERVAL_S != 16
+#error "SAMPLE_INTERVAL_S must be 4, 8 or 16"
+#endif
+
+#define SAMPLE_SIZE			(SAMPLE_INTERVAL_S * SAMPLE_RATE_HZ)
+#define BATCHES_PER_SECOND	(SAMPLE_RATE_HZ / BATCH_SIZE)
+#define SAMPLE_INTERVAL_MS	(1000 / SAMPLE_RATE_HZ)
+
+// Windows slide by half their length, and a half window has to be whole batches
+#if (SAMPLE_SIZE / 2) % BATCH_SIZE != 0
+#error "Half a window must be a whole number of batches"
+#endif
+
+// Gravity filter: the time constant is what the filter always had at 10 Hz (alpha = 0.5)
+#define FILTER_TIME_CONSTANT_S	0.1
+#define FILTER_CONSTANT		(1.0 / (1.0 + FILTER_TIME_CONSTANT_S * SAMPLE_RATE_HZ))
+
+// Step cadence
+#ifndef MAX_WALKING_SPEED
+#define MAX_WALKING_SPEED	3	// 3 steps per second
+#endif
+#define MIN_STEP_LAG		(SAMPLE_RATE_HZ * 3 / 10)	// Samples per step at 3.3 steps per second
+#define MAX_STEP_LAG		SAMPLE_RATE_HZ	// Samples per step at 1 step per second
+
+// Sample-to-sample differences shrink with the rate, squared differences with its square
+#define ENERGY_HF_SCALE		((SAMPLE_RATE_HZ / 10.0) * (SAMPLE_RATE_HZ / 10.0))
+
+#endif
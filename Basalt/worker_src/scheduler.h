@@ -0,0 +1,29 @@
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+#include <pebble_worker.h>
+
+#define SCHEDULER_DUTIES	4
+#define SCHEDULER_NEVER		UINT32_MAX
+
+// A duty runs once its deadline has passed; it must set its next deadline itself
+typedef void (*DutyHandler)(uint32_t now);
+
+typedef struct {
+	DutyHandler handlers[SCHEDULER_DUTIES];
+	uint32_t deadlines[SCHEDULER_DUTIES];
+	uint32_t size;
+	uint32_t next;	// Earliest deadline of all
+} Scheduler;
+
+void initScheduler(Scheduler* scheduler);
+uint32_t addDuty(Scheduler* scheduler, DutyHandler handler, uint32_t deadline);
+void setDeadline(Scheduler* scheduler, uint32_t duty, uint32_t deadline);
+void runDuties(Scheduler* scheduler, uint32_t now);
+
+// The only check on the hot path
+static inline bool hasDueDuty(Scheduler* scheduler, uint32_t now) {
+	return now >= scheduler->next;
+}
+
+#endif
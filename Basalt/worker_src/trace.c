@@ -0,0 +1,46 @@
+#include "trace.h"
+
+static TraceEvent mEvents[TRACE_SIZE];
+static uint32_t mNext = 0;	// Total events ever recorded; the ring holds the last TRACE_SIZE of them
+
+
+static uint64_t wallClock() {
+	time_t seconds;
+	uint16_t milliseconds = time_ms(&seconds, NULL);
+	return (uint64_t) seconds * 1000 + milliseconds;
+}
+
+static TraceClock mClock = &wallClock;
+
+
+void setTraceClock(TraceClock clock) {
+	mClock = clock;
+}
+
+
+void trace(uint16_t id, int32_t arg0, int32_t arg1) {
+	TraceEvent* event = &mEvents[mNext % TRACE_SIZE];
+	uint64_t now = mClock();
+	event->timestamp = (uint32_t) (now / 1000);
+	event->milliseconds = (uint16_t) (now % 1000);
+	event->id = id;
+	event->arg0 = arg0;
+	event->arg1 = arg1;
+	mNext++;
+}
+
+
+// Send the ring, oldest event first, to the phone and empty it
+void drainTrace() {
+	uint32_t first = mNext > TRACE_SIZE ? mNext - TRACE_SIZE : 0;
+	if (first == mNext)
+		return;
+
+	DataLoggingSessionRef session = data_logging_create(TRACE_DATA_LOG_TAG, DATA_LOGGING_BYTE_ARRAY, sizeof(TraceEvent), false);
+	for (uint32_t i = first; i < mNext; i++) {
+		data_logging_log(session, &mEvents[i % TRACE_SIZE], 1);
+	}
+	data_logging_finish(session);
+
+	mNext = 0;
+}
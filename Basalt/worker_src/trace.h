@@ -0,0 +1,62 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <pebble_worker.h>
+
+// Build with -DLOG_LEVEL=APP_LOG_LEVEL_DEBUG to get the per-window logs back
+#ifndef LOG_LEVEL
+#define LOG_LEVEL	APP_LOG_LEVEL_WARNING
+#endif
+
+// Anything above LOG_LEVEL is a constant false branch, so the compiler drops it with its format string
+#define LOG(level, fmt, ...) \
+	do { \
+		if ((level) <= LOG_LEVEL) \
+			APP_LOG((level), (fmt), ##__VA_ARGS__); \
+	} while (0)
+
+// One event per window by default, about two minutes of windows in 512 bytes. Build with -DTRACE_FEATURES to
+// also get every window's features, smoothing and step total, which fills the ring seven times as fast, and
+// give it a larger -DTRACE_SIZE to match.
+#ifndef TRACE_SIZE
+#define TRACE_SIZE	32	// Events kept in the ring
+#endif
+
+#define TRACE_DATA_LOG_TAG	1
+
+enum {
+	TRACE_FEATURE_MEAN = 1,	// meanV, meanH
+	TRACE_FEATURE_DEVIATION,	// deviationV, deviationH
+	TRACE_FEATURE_RHYTHM,	// energyHF, periodicity in percent
+	TRACE_CLASS,	// activity type | raw type << 8 | elapsed seconds << 16, steps in this window
+	TRACE_STEPS,	// steps in this window, steps today
+	TRACE_TRUTH,	// synthetic activity type, synthetic steps so far
+	TRACE_EPOCH,	// night mode activity count, 1 if scored as wake
+	TRACE_FEATURE_CADENCE,	// cadence in centihertz, cadence strength in percent
+	TRACE_SMOOTHING,	// type from classify(), smoothed type
+	TRACE_FILTER_SEED,	// mG between the first batch mean and the previous estimate, 1 if a saved estimate was kept
+	TRACE_POWER	// new power tier, battery charge in percent
+};
+
+// Where a recognizer sends its events, so that several recognizers need not share the worker's ring
+typedef void (*TraceSink)(uint16_t id, int32_t arg0, int32_t arg1);
+
+// Where the ring reads the time, in ms. The wall clock until the worker sets its own, so that a simulated
+// run stamps its events with simulated time.
+typedef uint64_t (*TraceClock)();
+
+// 16 bytes, little endian, as it goes out through data logging:
+// uint32 timestamp, uint16 milliseconds, uint16 id, int32 arg0, int32 arg1
+typedef struct {
+	uint32_t timestamp;
+	uint16_t milliseconds;
+	uint16_t id;
+	int32_t arg0;
+	int32_t arg1;
+} TraceEvent;
+
+void setTraceClock(TraceClock clock);
+void trace(uint16_t id, int32_t arg0, int32_t arg1);
+void drainTrace();
+
+#endif
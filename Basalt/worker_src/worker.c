@@ -1,10 +1,24 @@
 #include <pebble_worker.h>
 #include "recognizer.h"
+#include "profiler.h"
+#include "capture.h"
+#include "actigraphy.h"
+#include "scheduler.h"
+#include "rollup.h"
+#include "power.h"
+#ifdef SYNTHETIC_ACCEL
+#include "synthetic.h"
+#endif
 
 #define DATA_LOG_INTERVAL_S	60
+#define CHECKPOINT_INTERVAL_S	1800
+#define DAY_S	86400
+#define PROFILER_MESSAGE	110
+#define TRACE_MESSAGE		111
+#define CAPTURE_MESSAGE		112
 
 // Classification
-static LowPassFilter mFilter;
+static Recognizer mRecognizer;
 
 // Config
 static int32_t mResetTime = 0;	// Minutes since 00:00 e.g. 09:30 AM == 570
@@ -15,7 +29,61 @@ DataLoggingSessionRef mDataLog;
 
 static Counter mCounter;
 static Counter mLastCounter;
+static Counter mPushedCounter;	// What the watchface was last sent
 static uint32_t mActivityType = 0;
+static uint32_t mPushedType = 0;
+
+// Hourly, daily and weekly totals
+static Rollup mRollup;
+
+// Night mode
+static Actigraphy mActigraphy;
+static SleepLog mSleepLog;
+
+// Periodic duties, run in this order, on the counter's clock
+enum {
+	DATA_LOG_DUTY = 0,
+	RESET_DUTY,
+	CHECKPOINT_DUTY,
+	STATUS_DUTY
+};
+static Scheduler mScheduler;
+
+// Self-measurement
+static Profiler mProfiler;
+
+// Raw accelerometer capture, off unless asked for
+static Capture mCapture;
+
+// Battery: how much of the pipeline runs
+static Power mPower;
+static bool mSampling = false;	// Subscribed to the accelerometer
+
+#ifdef SYNTHETIC_ACCEL
+// Build with -DSYNTHETIC_ACCEL to feed the worker a deterministic trace instead of the accelerometer
+static Synthetic mSynthetic;
+// and with e.g. -DSYNTHETIC_SPEEDUP=600 to run ten simulated minutes per second, on the trace's own clock
+#ifndef SYNTHETIC_SPEEDUP
+#define SYNTHETIC_SPEEDUP	1
+#endif
+#endif
+
+
+// All the worker's clock reads go through here, so a simulated clock can replace the real one
+static uint64_t currentTimeMs() {
+#ifdef SYNTHETIC_ACCEL
+	return mSynthetic.timestamp;
+#else
+	time_t seconds;
+	uint16_t milliseconds = time_ms(&seconds, NULL);
+	return (uint64_t) seconds * 1000 + milliseconds;
+#endif
+}
+
+
+static uint32_t currentTime() {
+	return (uint32_t) (currentTimeMs() / 1000);
+}
 
 
 // Load persistent values
@@ -28,7 +96,12 @@ static void loadStatus() {
 	if (persist_exists(5)) {
 		mCounter.timestamp = persist_read_int(5);
 	} else {
-		mCounter.timestamp = (uint32_t) time(NULL);
+		mCounter.timestamp = currentTime();
+	}
+	if (persist_exists(SLEEP_LOG_KEY)) {
+		persist_read_data(SLEEP_LOG_KEY, &mSleepLog, sizeof(SleepLog));
+	} else {
+		initSleepLog(&mSleepLog);
 	}
 }
 
@@ -41,6 +114,12 @@ static void saveStatus() {
 	persist_write_int(3, mCounter.jogTime);
 	persist_write_int(4, mCounter.steps);
 	persist_write_int(5, mCounter.timestamp);
+	RecognizerState state;
+	saveRecognizer(&mRecognizer, mActivityType, &state);
+	persist_write_data(12, &state, sizeof(RecognizerState));
+	persist_write_data(ROLLUP_KEY, &mRollup, sizeof(Rollup));
+	persist_write_data(SLEEP_LOG_KEY, &mSleepLog, sizeof(SleepLog));
+	countEvent(&mProfiler, PROFILER_PERSIST_WRITES, 9);
 }
 
 
@@ -59,56 +138,294 @@ static void sendStatusToWatchface() {
 	app_worker_send_message(4, &message);
 	message.data0 = (uint16_t) mActivityType;
 	app_worker_send_message(5, &message);
+	countEvent(&mProfiler, PROFILER_STATUS_MESSAGES, 6);
+	mPushedCounter = mCounter;
+	mPushedType = mActivityType;
+}
+
+
+// Status changed since the last push, as far as the watchface can tell
+static bool statusChanged() {
+	return (uint16_t) mCounter.sleepTime != (uint16_t) mPushedCounter.sleepTime
+		|| (uint16_t) mCounter.sitTime != (uint16_t) mPushedCounter.sitTime
+		|| (uint16_t) mCounter.walkTime != (uint16_t) mPushedCounter.walkTime
+		|| (uint16_t) mCounter.jogTime != (uint16_t) mPushedCounter.jogTime
+		|| (uint16_t) mCounter.steps != (uint16_t) mPushedCounter.steps
+		|| mActivityType != mPushedType;
+}
+
+
+// First daily reset after now, the only place that needs the local time
+static uint32_t findNextResetTime(uint32_t now) {
+	time_t timeNow = (time_t) now;
+	struct tm* local = localtime(&timeNow);
+	uint32_t resetTime = now - (local->tm_hour * 3600 + local->tm_min * 60 + local->tm_sec) + mResetTime * 60;
+	if (resetTime <= now)
+		resetTime += DAY_S;
+	return resetTime;
+}
+
+
+static void resetCounter(uint32_t now) {
+	mCounter.sleepTime = 0;
+	mCounter.sitTime = 0;
+	mCounter.walkTime = 0;
+	mCounter.jogTime = 0;
+	mCounter.steps = 0;
+	mCounter.timestamp = now;
+}
+
+
+static void logData(uint32_t now) {
+	uint32_t sleepTime = mCounter.sleepTime - mLastCounter.sleepTime;
+	uint32_t sitTime = mCounter.sitTime - mLastCounter.sitTime;
+	uint32_t walkTime = mCounter.walkTime - mLastCounter.walkTime;
+	uint32_t jogTime = mCounter.jogTime - mLastCounter.jogTime;
+	uint32_t steps = mCounter.steps - mLastCounter.steps;
+	uint32_t timestamp = mCounter.timestamp;
+
+	// DataLogging: send to the companion app
+	int len = sizeof(uint32_t);
+	uint8_t bytes[len * 6];
+	memcpy(bytes + len * 0, &sleepTime, len);
+	memcpy(bytes + len * 1, &sitTime, len);
+	memcpy(bytes + len * 2, &walkTime, len);
+	memcpy(bytes + len * 3, &jogTime, len);
+	memcpy(bytes + len * 4, &steps, len);
+	memcpy(bytes + len * 5, &timestamp, len);
+	data_logging_log(mDataLog, &bytes, 1);
+	countEvent(&mProfiler, PROFILER_DATA_LOGS, 1);
+
+	mLastCounter = mCounter;
+	setDeadline(&mScheduler, DATA_LOG_DUTY, now + DATA_LOG_INTERVAL_S);
+}
+
+
+// Weekday of the day that starts at the reset before the given time
+static uint32_t findWeekday(uint32_t resetTime) {
+	time_t dayStart = (time_t) (resetTime - DAY_S);
+	return localtime(&dayStart)->tm_wday;
+}
+
+
+static void resetDaily(uint32_t now) {
+	// Send what the day gathered since the last data log before it is cleared. The data log duty comes first
+	// when both are due, and has often just sent it all.
+	if (mCounter.sleepTime != mLastCounter.sleepTime || mCounter.sitTime != mLastCounter.sitTime
+			|| mCounter.walkTime != mLastCounter.walkTime || mCounter.jogTime != mLastCounter.jogTime
+			|| mCounter.steps != mLastCounter.steps)
+		logData(now);
+	closeRollupDays(&mRollup, 1, findWeekday(findNextResetTime(now)));
+	resetCounter(now);
+	mLastCounter = mCounter;
+	setDeadline(&mScheduler, RESET_DUTY, findNextResetTime(now));
+}
+
+
+static void checkpoint(uint32_t now) {
+	saveStatus();
+	setDeadline(&mScheduler, CHECKPOINT_DUTY, now + CHECKPOINT_INTERVAL_S);
+}
+
+
+// Once per window at most, and only with news. The gated and suspended tiers move the counter clock every
+// batch or minute, the window schedule keeps them to the traffic of the full pipeline.
+static void pushStatus(uint32_t now) {
+	if (statusChanged())
+		sendStatusToWatchface();
+	setDeadline(&mScheduler, STATUS_DUTY, now + windowHop(&mRecognizer));
+}
+
+
+// Motion gate closed: the time goes to the last still type, sleep stays sleep and anything else becomes sitting
+static void countStillTime(uint32_t now) {
+	uint32_t elapsedTime = elapsedSince(&mCounter, now);
+	if (mActivityType == 0) {
+		mCounter.sleepTime += elapsedTime;
+	} else {
+		mActivityType = 1;
+		mCounter.sitTime += elapsedTime;
+	}
+	mCounter.timestamp = now;
+}
+
+
+// Accelerometer off: the time is not counted, but the duties and the rollup keep their clock
+static void processSuspended(uint32_t now) {
+	Counter previous = mCounter;
+	mCounter.timestamp = now;
+	addToRollup(&mRollup, now, &previous, &mCounter);
+	if (hasDueDuty(&mScheduler, now))
+		runDuties(&mScheduler, now);
+	countEvent(&mProfiler, PROFILER_SUSPENDED_MINUTES, 1);
+}
+
+
+static void processAccelerometerData(AccelData* acceleration, uint32_t size);
+
+
+#ifndef SYNTHETIC_ACCEL
+static void suspendedTick(struct tm* tickTime, TimeUnits unitsChanged) {
+	processSuspended(currentTime());
+}
+
+
+static void tapped(AccelAxisType axis, int32_t direction);
+#endif
+
+
+static void startSampling() {
+	if (mSampling)
+		return;
+	mSampling = true;
+	// The gap has no samples and the gravity estimate may be stale
+	mCounter.timestamp = currentTime();
+	clearWindow(&mRecognizer);
+	mPower.stillBatches = 0;
+#ifndef SYNTHETIC_ACCEL
+	tick_timer_service_unsubscribe();
+	accel_tap_service_unsubscribe();
+	accel_data_service_subscribe(BATCH_SIZE, &processAccelerometerData);
+	accel_service_set_sampling_rate(ACCEL_SAMPLING_RATE);
+#endif
+}
+
+
+static void stopSampling() {
+	if (!mSampling)
+		return;
+	mSampling = false;
+#ifndef SYNTHETIC_ACCEL
+	accel_data_service_unsubscribe();
+	accel_tap_service_subscribe(&tapped);
+	tick_timer_service_subscribe(MINUTE_UNIT, &suspendedTick);
+#endif
+}
+
+
+#ifndef SYNTHETIC_ACCEL
+// Suspended: a tap samples for a while, processAccelerometerData stops it again
+static void tapped(AccelAxisType axis, int32_t direction) {
+	mPower.wakeUntil = currentTime() + POWER_WAKE_S;
+	startSampling();
+}
+#endif
+
+
+static void setPowerTier(uint32_t tier, uint8_t charge) {
+	LOG(APP_LOG_LEVEL_INFO, "Power tier: %d (%d%%)", (int) tier, (int) charge);
+	trace(TRACE_POWER, (int32_t) tier, (int32_t) charge);
+	mPower.tier = tier;
+	mPower.stillBatches = 0;
+	setOverlap(&mRecognizer, tier == POWER_FULL);
+	if (tier == POWER_SUSPENDED && currentTime() >= mPower.wakeUntil) {
+		stopSampling();
+	} else if (tier != POWER_SUSPENDED) {
+		startSampling();
+	}
+}
+
+
+static void batteryChanged(BatteryChargeState state) {
+	uint32_t tier = choosePowerTier(mPower.tier, state);
+	if (tier != mPower.tier)
+		setPowerTier(tier, state.charge_percent);
 }
 
 
 // Handle accleration data
 static void processAccelerometerData(AccelData* acceleration, uint32_t size) {
+	// Woken by a tap while suspended: sample like the motion gated tier until the wake-up runs out
+	if (mPower.tier == POWER_SUSPENDED && currentTime() >= mPower.wakeUntil) {
+		stopSampling();
+		return;
+	}
+
+	uint32_t start = profilerClock();
+	countEvent(&mProfiler, PROFILER_ACCEL_CALLBACKS, 1);
+	countEvent(&mProfiler, PROFILER_SAMPLES, size);
+
+	captureSamples(&mCapture, acceleration, size, mActivityType);
+
+	Counter previous = mCounter;
+
+	// Night mode: only count activity, no classification
+	if (isSleeping(&mActigraphy)) {
+		uint32_t result = trackSleep(&mActigraphy, &mSleepLog, &mCounter, currentTime(), acceleration, size);
+		if (result == 1) {
+			// Back to the full pipeline with a fresh window
+			mActivityType = 1;
+			clearWindow(&mRecognizer);
+		}
+		if (result != 2)
+			addToRollup(&mRollup, mCounter.timestamp, &previous, &mCounter);
+		if (hasDueDuty(&mScheduler, mCounter.timestamp))
+			runDuties(&mScheduler, mCounter.timestamp);
+		return;
+	}
+
+	// Low battery: past a few still batches, skip the recognizer and start a fresh window once it moves again
+	if (mPower.tier >= POWER_MOTION_GATED) {
+		if (!gateMotion(&mPower, acceleration, size)) {
+			if (mPower.stillBatches == POWER_STILL_BATCHES + 1)
+				clearWindow(&mRecognizer);
+			countStillTime(currentTime());
+			// Every window's worth of stillness goes to night mode as a window of the still type
+			if (mPower.stillBatches % POWER_STILL_BATCHES == 0)
+				noteActivity(&mActigraphy, mActivityType);
+			addToRollup(&mRollup, mCounter.timestamp, &previous, &mCounter);
+			if (hasDueDuty(&mScheduler, mCounter.timestamp))
+				runDuties(&mScheduler, mCounter.timestamp);
+			countEvent(&mProfiler, PROFILER_GATED_BATCHES, 1);
+			return;
+		}
+	}
+
+	uint32_t lastType = mActivityType;
+	uint32_t lastRawType = mRecognizer.rawType;
+
 	// Throw the variables into below function, it will update it for you.
-	uint32_t result = analyzeAcceleration(&mActivityType, &mCounter, &mFilter, mPedometerSensitivity, acceleration, size);
+	uint32_t result = analyzeAcceleration(&mRecognizer, &mActivityType, &mCounter, currentTime(), mPedometerSensitivity, acceleration, size);
 	if (result == 0) {
-		// Check if need to send a data log
-		if (mCounter.timestamp - mLastCounter.timestamp >= DATA_LOG_INTERVAL_S) {
-			uint32_t sleepTime = mCounter.sleepTime - mLastCounter.sleepTime;
-			uint32_t sitTime = mCounter.sitTime - mLastCounter.sitTime;
-			uint32_t walkTime = mCounter.walkTime - mLastCounter.walkTime;
-			uint32_t jogTime = mCounter.jogTime - mLastCounter.jogTime;
-			uint32_t steps = mCounter.steps - mLastCounter.steps;
-			uint32_t timestamp = mCounter.timestamp;
-
-			// DataLogging: send to the companion app
-			int len = sizeof(uint32_t);
-			uint8_t bytes[len * 6];
-			memcpy(bytes + len * 0, &sleepTime, len);
-			memcpy(bytes + len * 1, &sitTime, len);
-			memcpy(bytes + len * 2, &walkTime, len);
-			memcpy(bytes + len * 3, &jogTime, len);
-			memcpy(bytes + len * 4, &steps, len);
-			memcpy(bytes + len * 5, &timestamp, len);
-			data_logging_log(mDataLog, &bytes, 1);
-
-			// Check if needs a reset
-			time_t timeNow = time(NULL);
-			struct tm* now = localtime(&timeNow);
-			uint32_t currentTime = (uint32_t) timeNow;
-			uint32_t resetTime = (uint32_t) timeNow;
-			resetTime = resetTime - (now->tm_hour * 3600 + now->tm_min * 60 + now->tm_sec) + mResetTime * 60;
-			if (mLastCounter.timestamp <= resetTime && resetTime <= currentTime) {
-				mCounter.sleepTime = 0;
-				mCounter.sitTime = 0;
-				mCounter.walkTime = 0;
-				mCounter.jogTime = 0;
-				mCounter.steps = 0;
-				mCounter.timestamp = currentTime;
-			}
+		addToRollup(&mRollup, mCounter.timestamp, &previous, &mCounter);
+		if (hasDueDuty(&mScheduler, mCounter.timestamp))
+			runDuties(&mScheduler, mCounter.timestamp);
+		noteActivity(&mActigraphy, mActivityType);
+		if (mRecognizer.rawType != lastRawType)
+			countEvent(&mProfiler, PROFILER_RAW_TYPE_CHANGES, 1);
+		if (mActivityType != lastType)
+			countEvent(&mProfiler, PROFILER_TYPE_CHANGES, 1);
 
-			mLastCounter = mCounter;
+		countEvent(&mProfiler, PROFILER_WINDOWS, 1);
+		recordWindowTime(&mProfiler, start);
+		sampleHeap(&mProfiler);
+	}
+}
+
+
+#ifdef SYNTHETIC_ACCEL
+static void generateAccelerometerData(struct tm* tickTime, TimeUnits unitsChanged) {
+	static uint32_t batches = 0;
+	AccelData samples[BATCH_SIZE];
+
+	for (uint32_t i = 0; i < SYNTHETIC_SPEEDUP * BATCHES_PER_SECOND; i++) {
+		generateSamples(&mSynthetic, samples, BATCH_SIZE);
+		// Suspended: the trace still moves the simulated clock, a minute at a time
+		if (!mSampling) {
+			if (mSynthetic.timestamp % 60000 == 0)
+				processSuspended(currentTime());
+			continue;
 		}
+		processAccelerometerData(samples, BATCH_SIZE);
 
-		// Send a status update to watchface
-		sendStatusToWatchface();
+		// Ground truth once per window
+		batches++;
+		if (batches % (SAMPLE_SIZE / 2 / BATCH_SIZE) == 0) {
+			trace(TRACE_TRUTH, (int32_t) syntheticLabel(&mSynthetic), (int32_t) mSynthetic.steps);
+		}
 	}
 }
+#endif
 
 
 // App Message Sync
@@ -119,10 +436,28 @@ static void workerMessageReceived(uint16_t type, AppWorkerMessage *data) {
 			break;
 		case 101:
 			mResetTime = (int32_t) data->data0;
+			setDeadline(&mScheduler, RESET_DUTY, findNextResetTime(mCounter.timestamp));
 			break;
 		case 102:
 			mPedometerSensitivity = (int32_t) data->data0;
 			break;
+		case TRACE_MESSAGE:	// Send the trace ring through data logging
+			drainTrace();
+			break;
+		case CAPTURE_MESSAGE:	// 1: start capturing raw samples, 0: stop
+			if (data->data0 == 1) {
+				startCapture(&mCapture);
+			} else {
+				stopCapture(&mCapture);
+			}
+			break;
+		case PROFILER_MESSAGE:	// 0: report the counters, 1: reset them
+			if (data->data0 == 1) {
+				resetProfiler(&mProfiler);
+			} else {
+				sendProfilerReport(&mProfiler, PROFILER_MESSAGE);
+			}
+			break;
 		default:
 			break;
 	}
@@ -130,35 +465,65 @@ static void workerMessageReceived(uint16_t type, AppWorkerMessage *data) {
 
 
 static void init() {
+#ifdef SYNTHETIC_ACCEL
+	// The simulated clock starts now
+	initSynthetic(&mSynthetic, 1, (uint64_t) time(NULL) * 1000);
+#endif
+	setTraceClock(&currentTimeMs);
+
 	// Load persistent values
 	loadStatus();
 
-	// Check if needs a reset
-	time_t timeNow = time(NULL);
-	struct tm* now = localtime(&timeNow);
-	uint32_t currentTime = (uint32_t) timeNow;
-	uint32_t resetTime = (uint32_t) timeNow;
-	resetTime = resetTime - (now->tm_hour * 3600 + now->tm_min * 60 + now->tm_sec) + mResetTime * 60;
-	if (mCounter.timestamp <= resetTime && resetTime <= currentTime) {
-		mCounter.sleepTime = 0;
-		mCounter.sitTime = 0;
-		mCounter.walkTime = 0;
-		mCounter.jogTime = 0;
-		mCounter.steps = 0;
+	// Check if a reset was missed while the worker was not running
+	uint32_t now = currentTime();
+	uint32_t nextResetTime = findNextResetTime(now);
+	if (persist_exists(ROLLUP_KEY)) {
+		persist_read_data(ROLLUP_KEY, &mRollup, sizeof(Rollup));
+	} else {
+		initRollup(&mRollup, now);
 	}
-	mCounter.timestamp = currentTime;
+	if (mCounter.timestamp <= nextResetTime - DAY_S) {
+		closeRollupDays(&mRollup, (nextResetTime - DAY_S - mCounter.timestamp) / DAY_S + 1, findWeekday(nextResetTime));
+		resetCounter(now);
+	}
+	mCounter.timestamp = now;
 	mLastCounter = mCounter;
 
+	// Periodic duties
+	initScheduler(&mScheduler);
+	addDuty(&mScheduler, &logData, now + DATA_LOG_INTERVAL_S);
+	addDuty(&mScheduler, &resetDaily, nextResetTime);
+	addDuty(&mScheduler, &checkpoint, now + CHECKPOINT_INTERVAL_S);
+	addDuty(&mScheduler, &pushStatus, now + windowHop(&mRecognizer));
+
 	// Initialize data log
 	// DataLogging
 	mDataLog = data_logging_create(0, DATA_LOGGING_BYTE_ARRAY, sizeof(uint32_t) * 6, false);
 
 	// For accelerometer
+#ifdef SYNTHETIC_ACCEL
+	tick_timer_service_subscribe(SECOND_UNIT, &generateAccelerometerData);
+#else
 	accel_data_service_subscribe(BATCH_SIZE, &processAccelerometerData);
-	accel_service_set_sampling_rate(ACCEL_SAMPLING_10HZ);
+	accel_service_set_sampling_rate(ACCEL_SAMPLING_RATE);
+#endif
+	mSampling = true;
+
+	// Initiate recognizer, warm if the last run left its state
+	initRecognizer(&mRecognizer);
+	mRecognizer.sink = &trace;
+	if (persist_exists(12)) {
+		RecognizerState state;
+		persist_read_data(12, &state, sizeof(RecognizerState));
+		restoreRecognizer(&mRecognizer, &mActivityType, &state);
+	}
+	resetProfiler(&mProfiler);
+	sampleHeap(&mProfiler);
 
-	// Initiate low pass filter
-	initLowPassFilter(&mFilter);
+	// Start in the tier the battery allows
+	initPower(&mPower);
+	battery_state_service_subscribe(&batteryChanged);
+	batteryChanged(battery_state_service_peek());
 
 	// AppWorkerMessage
 	app_worker_message_subscribe(&workerMessageReceived);
@@ -170,8 +535,19 @@ static void deinit() {
 
 	// Close data log
 	data_logging_finish(mDataLog);
+	stopCapture(&mCapture);
+	battery_state_service_unsubscribe();
 	// Unsubscribe acceleration
-	accel_data_service_unsubscribe();
+#ifdef SYNTHETIC_ACCEL
+	tick_timer_service_unsubscribe();
+#else
+	if (mSampling) {
+		accel_data_service_unsubscribe();
+	} else {
+		accel_tap_service_unsubscribe();
+		tick_timer_service_unsubscribe();
+	}
+#endif
 	// Unsubscribe worker message
 	app_worker_message_unsubscribe();
 }
@@ -0,0 +1,34 @@
+// Decode a capture stream (data logging tag 2 items, concatenated) into CSV: timestamp,x,y,z,vibrate,label
+// Usage: capture_decode [file]
+#include "capture_reader.h"
+#include "loadfile.h"
+
+
+int main(int argc, char** argv) {
+	size_t size;
+	uint8_t* bytes = loadFile(argc > 1 ? argv[1] : NULL, &size);
+	if (bytes == NULL)
+		return 1;
+
+	CaptureReader reader;
+	if (!initCaptureReader(&reader, bytes, size)) {
+		fprintf(stderr, "not a capture stream\n");
+		return 1;
+	}
+
+	printf("timestamp,x,y,z,vibrate,label\n");
+	AccelData samples[CAPTURE_BLOCK_SIZE];
+	uint8_t label;
+	int32_t count;
+	while ((count = readCaptureBlock(&reader, samples, &label)) > 0) {
+		for (int32_t i = 0; i < count; i++) {
+			printf("%llu,%d,%d,%d,%d,%u\n", (unsigned long long) samples[i].timestamp, samples[i].x, samples[i].y, samples[i].z, samples[i].did_vibrate, label);
+		}
+	}
+	free(bytes);
+	if (count < 0) {
+		fprintf(stderr, "stream cut short at byte %zu\n", reader.offset);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,99 @@
+#include "capture_reader.h"
+
+#define PREAMBLE_SIZE		6
+#define BLOCK_HEADER_SIZE	24
+
+
+static uint64_t readLittle(const uint8_t* bytes, uint32_t size) {
+	uint64_t value = 0;
+	for (uint32_t i = 0; i < size; i++) {
+		value |= (uint64_t) bytes[i] << (8 * i);
+	}
+	return value;
+}
+
+
+static int32_t unzigzag(uint32_t value) {
+	return (int32_t) (value >> 1) ^ -(int32_t) (value & 1);
+}
+
+
+bool initCaptureReader(CaptureReader* reader, const uint8_t* bytes, size_t size) {
+	if (size < PREAMBLE_SIZE || readLittle(bytes, 3) != CAPTURE_MAGIC || bytes[3] != CAPTURE_VERSION)
+		return false;
+	reader->bytes = bytes;
+	reader->size = size;
+	reader->version = bytes[3];
+	reader->rate = bytes[4];
+	reader->blockSize = bytes[5];
+	reader->offset = PREAMBLE_SIZE;
+	return reader->blockSize > 0 && reader->blockSize <= 32;
+}
+
+
+int32_t readCaptureBlock(CaptureReader* reader, AccelData* samples, uint8_t* label) {
+	if (reader->offset >= reader->size || reader->bytes[reader->offset] == 0)
+		return 0;
+	if (reader->offset + BLOCK_HEADER_SIZE > reader->size)
+		return -1;
+
+	const uint8_t* header = reader->bytes + reader->offset;
+	uint32_t count = header[0];
+	if (count > reader->blockSize)
+		return -1;
+	*label = header[1];
+	uint64_t timestamp = readLittle(header + 2, 8);
+	int32_t values[3] = {
+		(int16_t) readLittle(header + 10, 2),
+		(int16_t) readLittle(header + 12, 2),
+		(int16_t) readLittle(header + 14, 2)
+	};
+	const uint8_t* widths = header + 16;
+	uint32_t vibrate = (uint32_t) readLittle(header + 20, 4);
+
+	// Deltas: all of x, then y, z and time, LSB first
+	uint32_t bits = 0;
+	for (uint32_t column = 0; column < 4; column++) {
+		bits += widths[column] * (count - 1);
+	}
+	size_t end = reader->offset + BLOCK_HEADER_SIZE + (bits + 7) / 8;
+	if (end > reader->size)
+		return -1;
+
+	const uint8_t* packed = header + BLOCK_HEADER_SIZE;
+	uint32_t position = 0;
+	for (uint32_t column = 0; column < 4; column++) {
+		for (uint32_t i = 0; i < count; i++) {
+			if (i > 0) {
+				uint32_t value = 0;
+				for (uint32_t bit = 0; bit < widths[column]; bit++, position++) {
+					value |= (uint32_t) ((packed[position / 8] >> (position % 8)) & 1) << bit;
+				}
+				int32_t delta = unzigzag(value);
+				if (column < 3) {
+					values[column] += delta;
+				} else {
+					timestamp += CAPTURE_INTERVAL_MS + delta;
+				}
+			}
+			switch (column) {
+				case 0:
+					samples[i].x = (int16_t) values[0];
+					break;
+				case 1:
+					samples[i].y = (int16_t) values[1];
+					break;
+				case 2:
+					samples[i].z = (int16_t) values[2];
+					break;
+				default:
+					samples[i].timestamp = timestamp;
+					samples[i].did_vibrate = (vibrate >> i) & 1;
+					break;
+			}
+		}
+	}
+
+	reader->offset = end;
+	return (int32_t) count;
+}
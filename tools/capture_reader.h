@@ -0,0 +1,21 @@
+#ifndef _CAPTURE_READER_H_
+#define _CAPTURE_READER_H_
+
+#include "capture.h"
+
+// Reads the stream described in capture.h back into samples, exactly as the worker saw them
+typedef struct {
+	const uint8_t* bytes;
+	size_t size;
+	size_t offset;	// Next byte
+	uint32_t version;
+	uint32_t rate;
+	uint32_t blockSize;
+} CaptureReader;
+
+// False if the bytes do not start with a capture preamble this reader knows
+bool initCaptureReader(CaptureReader* reader, const uint8_t* bytes, size_t size);
+// Up to CAPTURE_BLOCK_SIZE samples into samples; 0 at the end of the stream, -1 if the stream is cut short
+int32_t readCaptureBlock(CaptureReader* reader, AccelData* samples, uint8_t* label);
+
+#endif
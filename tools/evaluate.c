@@ -0,0 +1,189 @@
+// Replay traces through the recognizer on every core and score it against their ground truth.
+// Usage: evaluate [-j threads] [-s sensitivity] [-n] trace...
+// -n replays with windows that do not overlap, as the worker does on a low battery. Prints one line per
+// trace (accuracy, steps against the truth, CPU time) and the confusion matrix over all of them.
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "pipeline.h"
+
+static const char* const LABELS[] = TRACEFILE_ACTIVITY_LABELS;
+
+typedef struct {
+	const char* path;
+	bool ok;
+	uint64_t samples;
+	uint64_t confusion[ACTIVITY_TYPES][ACTIVITY_TYPES];	// Truth by recognized type, in windows
+	uint64_t windows;
+	uint64_t right;
+	uint64_t steps;
+	uint64_t truthSteps;	// TRACEFILE_NO_STEPS if the trace has none
+	double seconds;	// Thread CPU time
+} Result;
+
+static Result* mResults;
+static uint32_t mTraceCount;
+static uint32_t mNext;	// Next trace to take, shared by the workers
+static int32_t mSensitivity = 50;
+static bool mOverlap = true;
+
+
+static double cpuSeconds() {
+	struct timespec now;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+static void replayTrace(Result* result) {
+	TraceFile trace;
+	if (! openTraceFile(&trace, result->path))
+		return;
+	if (trace.header->rate != SAMPLE_RATE_HZ) {
+		fprintf(stderr, "%s: %u Hz, the recognizer is built for %u Hz\n", result->path, trace.header->rate, SAMPLE_RATE_HZ);
+		closeTraceFile(&trace);
+		return;
+	}
+	double started = cpuSeconds();
+
+	// One recognizer per trace, as on a freshly installed watch
+	Recognizer recognizer;
+	initRecognizer(&recognizer);
+	setOverlap(&recognizer, mOverlap);
+	uint32_t type = 1;
+	Counter counter;
+	memset(&counter, 0, sizeof(Counter));
+	counter.timestamp = trace.header->sampleCount > 0 ? (uint32_t) (trace.samples[0].timestamp / 1000) : 0;
+
+	uint64_t sample = 0;
+	TraceBatch batch;
+	uint32_t lastSteps = 0;
+	while (traceBatch(&trace, sample, nextBatchSize(&recognizer), &batch)) {
+		uint32_t timestamp = (uint32_t) (batch.samples[batch.count - 1].timestamp / 1000);
+		// The recognizer only reads the samples; the mapping is read-only
+		if (analyzeAcceleration(&recognizer, &type, &counter, timestamp, NOT_DRIVING mSensitivity, (AccelData*) batch.samples, batch.count) == 0) {
+			result->confusion[batch.label < ACTIVITY_TYPES ? batch.label : 0][type]++;
+			result->windows++;
+			if (batch.label == type)
+				result->right++;
+		}
+		sample += batch.count;
+		lastSteps = batch.steps;
+	}
+
+	result->samples = trace.header->sampleCount;
+	result->steps = counter.steps;
+	result->truthSteps = trace.header->flags & TRACEFILE_STEPS ? lastSteps : TRACEFILE_NO_STEPS;
+	result->seconds = cpuSeconds() - started;
+	result->ok = true;
+	closeTraceFile(&trace);
+}
+
+
+static void* work(void* unused) {
+	uint32_t index;
+	while ((index = __atomic_fetch_add(&mNext, 1, __ATOMIC_RELAXED)) < mTraceCount) {
+		replayTrace(&mResults[index]);
+	}
+	return NULL;
+}
+
+
+int main(int argc, char** argv) {
+	uint32_t threads = (uint32_t) sysconf(_SC_NPROCESSORS_ONLN);
+	int option;
+	while ((option = getopt(argc, argv, "j:s:n")) != -1) {
+		switch (option) {
+			case 'j':
+				threads = (uint32_t) atoi(optarg);
+				break;
+			case 's':
+				mSensitivity = atoi(optarg);
+				break;
+			case 'n':
+				mOverlap = false;
+				break;
+			default:
+				fprintf(stderr, "usage: evaluate [-j threads] [-s sensitivity] [-n] trace...\n");
+				return 1;
+		}
+	}
+	mTraceCount = (uint32_t) (argc - optind);
+	if (mTraceCount == 0 || threads == 0) {
+		fprintf(stderr, "usage: evaluate [-j threads] [-s sensitivity] [-n] trace...\n");
+		return 1;
+	}
+	mResults = calloc(mTraceCount, sizeof(Result));
+	for (uint32_t i = 0; i < mTraceCount; i++) {
+		mResults[i].path = argv[optind + i];
+	}
+
+	// Workers take the next trace as they finish one, so a long trace does not hold up a shard of short ones
+	struct timespec began, ended;
+	clock_gettime(CLOCK_MONOTONIC, &began);
+	if (threads > mTraceCount)
+		threads = mTraceCount;
+	pthread_t* pool = calloc(threads, sizeof(pthread_t));
+	for (uint32_t i = 0; i < threads; i++) {
+		pthread_create(&pool[i], NULL, &work, NULL);
+	}
+	for (uint32_t i = 0; i < threads; i++) {
+		pthread_join(pool[i], NULL);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ended);
+
+	Result total;
+	memset(&total, 0, sizeof(Result));
+	bool ok = true;
+	printf("trace,samples,windows,accuracy,steps,truth_steps,step_error,cpu_s,samples_per_s\n");
+	for (uint32_t i = 0; i < mTraceCount; i++) {
+		Result* result = &mResults[i];
+		if (! result->ok) {
+			ok = false;
+			continue;
+		}
+		printf("%s,%llu,%llu,%.3f,%llu,", result->path, (unsigned long long) result->samples, (unsigned long long) result->windows,
+				result->windows > 0 ? (double) result->right / result->windows : 0, (unsigned long long) result->steps);
+		if (result->truthSteps != TRACEFILE_NO_STEPS) {
+			printf("%llu,%.3f,", (unsigned long long) result->truthSteps,
+					result->truthSteps > 0 ? ((double) result->steps - result->truthSteps) / result->truthSteps : 0);
+			total.truthSteps += result->truthSteps;
+			total.steps += result->steps;
+		} else {
+			printf(",,");
+		}
+		printf("%.3f,%.0f\n", result->seconds, result->seconds > 0 ? result->samples / result->seconds : 0);
+
+		for (uint32_t truth = 0; truth < ACTIVITY_TYPES; truth++) {
+			for (uint32_t type = 0; type < ACTIVITY_TYPES; type++) {
+				total.confusion[truth][type] += result->confusion[truth][type];
+			}
+		}
+		total.samples += result->samples;
+		total.windows += result->windows;
+		total.right += result->right;
+		total.seconds += result->seconds;
+	}
+
+	double wall = (ended.tv_sec - began.tv_sec) + (ended.tv_nsec - began.tv_nsec) / 1e9;
+	fprintf(stderr, "\nconfusion, truth by recognized type (windows):\n%10s", "");
+	for (uint32_t type = 0; type < ACTIVITY_TYPES; type++) {
+		fprintf(stderr, "%10s", LABELS[type]);
+	}
+	fprintf(stderr, "\n");
+	for (uint32_t truth = 0; truth < ACTIVITY_TYPES; truth++) {
+		fprintf(stderr, "%10s", LABELS[truth]);
+		for (uint32_t type = 0; type < ACTIVITY_TYPES; type++) {
+			fprintf(stderr, "%10llu", (unsigned long long) total.confusion[truth][type]);
+		}
+		fprintf(stderr, "\n");
+	}
+	fprintf(stderr, "accuracy %.3f over %llu windows", total.windows > 0 ? (double) total.right / total.windows : 0,
+			(unsigned long long) total.windows);
+	if (total.truthSteps > 0)
+		fprintf(stderr, ", steps %llu against %llu (%+.1f%%)", (unsigned long long) total.steps, (unsigned long long) total.truthSteps,
+				100.0 * ((double) total.steps - total.truthSteps) / total.truthSteps);
+	fprintf(stderr, "\n%u threads, %.2f s wall, %.2f s CPU, %.1f M samples/s\n", threads, wall, total.seconds,
+			wall > 0 ? total.samples / wall / 1e6 : 0);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+// Dump the windows the decision forest is trained on.
+// Usage: forest_dump [-s seed] [-n segments]
+// Every segment is one activity with its parameters drawn from defaultGeneratorConfig's ranges, like
+// synthesize's, but it lasts whole seconds and starts with a cleared window, so no window mixes two types.
+// Each window goes through the recognizer and is printed as CSV: the true type, the eight features as
+// quantizeFeature gives them to the forest and the type classify() of this build picked.
+// forest_train.py turns the dumps into forest.c's tables; README.md has the exact commands.
+#include <math.h>
+#include <unistd.h>
+#include "pipeline.h"
+#include "generator.h"
+#include "forest.h"
+
+static uint32_t mSeed = 1;
+
+
+// xorshift32 as in generator.c, drawn in the same order for every run of a seed
+static double uniform() {
+	mSeed ^= mSeed << 13;
+	mSeed ^= mSeed >> 17;
+	mSeed ^= mSeed << 5;
+	return (mSeed % 1000000) / 1000000.0;
+}
+
+
+static double draw(Range range) {
+	return range.low + (range.high - range.low) * uniform();
+}
+
+
+int main(int argc, char** argv) {
+	uint32_t segments = 300;
+	int option;
+	while ((option = getopt(argc, argv, "s:n:")) != -1) {
+		switch (option) {
+			case 's':
+				mSeed = (uint32_t) strtoul(optarg, NULL, 10);
+				break;
+			case 'n':
+				segments = (uint32_t) strtoul(optarg, NULL, 10);
+				break;
+			default:
+				fprintf(stderr, "usage: forest_dump [-s seed] [-n segments]\n");
+				return 1;
+		}
+	}
+	if (mSeed == 0)
+		mSeed = 1;
+
+	GeneratorConfig config;
+	defaultGeneratorConfig(&config);
+	uint32_t total = 0;
+	for (uint32_t i = 0; i < GENERATOR_TYPES; i++) {
+		total += config.weights[i];
+	}
+
+	Recognizer recognizer;
+	initRecognizer(&recognizer);
+	Recognizer scratch;
+	uint32_t type = 1;
+	Counter counter;
+	memset(&counter, 0, sizeof(Counter));
+	uint32_t timestamp = 0;
+	uint32_t windows = 0;
+	double phase = 0;	// 2 pi per step, carried from one segment to the next
+
+	printf("label,mean_v,mean_h,deviation_v,deviation_h,energy_hf,periodicity,cadence,cadence_strength,classify\n");
+	for (uint32_t segment = 0; segment < segments; segment++) {
+		uint32_t pick = (uint32_t) (uniform() * total);
+		uint32_t label = 0;
+		while (pick >= config.weights[label]) {
+			pick -= config.weights[label];
+			label++;
+		}
+		uint32_t samples = (uint32_t) draw(config.seconds) * SAMPLE_RATE_HZ;
+
+		double cadence = 0, bounce = 0, swing = 0, vibration = 0, fidget = 0;
+		switch (label) {
+			case GENERATOR_WALK:
+				cadence = draw(config.walkCadence);
+				bounce = draw(config.walkBounce);
+				swing = draw(config.walkSwing);
+				break;
+			case GENERATOR_JOG:
+				cadence = draw(config.jogCadence);
+				bounce = draw(config.jogBounce);
+				swing = draw(config.jogSwing);
+				break;
+			case GENERATOR_DRIVING:
+				vibration = draw(config.vibration);
+				break;
+			case GENERATOR_SIT:
+				fidget = draw(config.fidget);
+				break;
+		}
+		// The tilt is drawn for every segment and drawn again for sleep, the training set was made that way
+		double tilt = draw(config.tilt);
+		if (label == GENERATOR_SLEEP)
+			tilt = draw(config.sleepTilt);
+		double noise = draw(config.noise);
+		double gravityY = 1000 * sin(tilt);
+		double gravityZ = -1000 * cos(tilt);
+		double gesture = 0;
+		uint32_t gestureLeft = 0;
+
+		clearWindow(&recognizer);
+		AccelData batch[BATCH_SIZE];
+		for (uint32_t i = 0; i < samples; i++) {
+			double v = 0;
+			double h = 0;
+			if (cadence > 0) {
+				v = bounce * sin(phase);
+				h = swing * sin(phase / 2);
+				phase += 2 * M_PI * cadence / 60 / SAMPLE_RATE_HZ;
+				if (phase > 4 * M_PI)
+					phase -= 4 * M_PI;
+			}
+			v += draw((Range) { -vibration, vibration });
+			if (fidget > 0) {
+				if (gestureLeft == 0 && uniform() < 0.01 * fidget) {
+					gestureLeft = (uint32_t) draw((Range) { 5, 30 });
+					gesture = draw(config.gesture);
+				}
+				if (gestureLeft > 0) {
+					gestureLeft--;
+					v += gesture * sin(gestureLeft * 0.7);
+					h += gesture * 0.7 * cos(gestureLeft * 0.5);
+				}
+			}
+
+			AccelData* sample = &batch[i % BATCH_SIZE];
+			sample->x = (int16_t) (h + draw((Range) { -noise, noise }));
+			sample->y = (int16_t) (gravityY + v * gravityY / 1000 + draw((Range) { -noise, noise }));
+			sample->z = (int16_t) (gravityZ + v * gravityZ / 1000 + draw((Range) { -noise, noise }));
+			sample->did_vibrate = false;
+			sample->timestamp = 0;
+			if ((i + 1) % BATCH_SIZE != 0)
+				continue;
+
+			// As in sweep's cache: the whole window only exists during the call
+			scratch = recognizer;
+			timestamp++;
+			if (analyzeAcceleration(&recognizer, &type, &counter, timestamp, NOT_DRIVING 50, batch, BATCH_SIZE) == 0) {
+				memcpy(scratch.window + SAMPLE_SIZE / 2, recognizer.window, SAMPLE_SIZE / 2 * sizeof(Projection));
+				scratch.dataSize = SAMPLE_SIZE;
+				Feature feature;
+				extractFeature(&scratch, &feature);
+				int8_t quantized[FOREST_FEATURES];
+				quantizeFeature(&feature, quantized);
+
+				printf("%u", label);
+				for (uint32_t k = 0; k < FOREST_FEATURES; k++) {
+					printf(",%d", quantized[k]);
+				}
+				printf(",%u\n", recognizer.rawType);
+				windows++;
+			}
+		}
+	}
+	fprintf(stderr, "%u segments, %u windows\n", segments, windows);
+	return 0;
+}
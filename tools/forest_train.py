@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+# Train the decision forest on forest_dump windows and print forest.c's tables.
+# Usage: forest_train.py [-t trees] [-d depth] [-f features] [-l min_leaf] [-r seed] [-e test.csv]... train.csv...
+# CART trees on Gini impurity, each grown on a bootstrap of the training windows and choosing every split
+# among a random subset of the features. A leaf votes for its majority type with its purity in percent.
+# Accuracy on the -e windows, the forest's and the dump's own classify(), goes to stderr. The same
+# arguments and dumps give the same tables: Python's random is the only source of chance.
+import argparse
+import csv
+import random
+import sys
+
+TYPES = 5
+FEATURES = ['FOREST_MEAN_V', 'FOREST_MEAN_H', 'FOREST_DEVIATION_V', 'FOREST_DEVIATION_H', 'FOREST_ENERGY_HF',
+        'FOREST_PERIODICITY', 'FOREST_CADENCE', 'FOREST_CADENCE_STRENGTH']
+
+
+def load(paths):
+    # (quantized features, true type, classify() of the dump's build) per window
+    windows = []
+    for path in paths:
+        with open(path) as f:
+            reader = csv.reader(f)
+            next(reader)
+            for row in reader:
+                values = list(map(int, row))
+                windows.append((values[1:1 + len(FEATURES)], values[0], values[-1]))
+    return windows
+
+
+def gini(counts, n):
+    return 1 - sum((count / n) ** 2 for count in counts) if n else 0
+
+
+# The threshold on one of the features that leaves the least impurity, or None when no split beats the node
+def bestSplit(windows, features, minLeaf):
+    n = len(windows)
+    total = [0] * TYPES
+    for _, label, _ in windows:
+        total[label] += 1
+    best = (gini(total, n) - 1e-9, None, None)
+    for feature in features:
+        ordered = sorted(windows, key=lambda window: window[0][feature])
+        left = [0] * TYPES
+        for i in range(n - 1):
+            left[ordered[i][1]] += 1
+            value = ordered[i][0][feature]
+            if value == ordered[i + 1][0][feature] or i + 1 < minLeaf or n - i - 1 < minLeaf:
+                continue
+            right = [t - l for t, l in zip(total, left)]
+            impurity = ((i + 1) * gini(left, i + 1) + (n - i - 1) * gini(right, n - i - 1)) / n
+            if impurity < best[0]:
+                best = (impurity, feature, value)
+    return best[1], best[2]
+
+
+# ('node', feature, threshold, left, right) or ('leaf', type, weight)
+def grow(windows, depth, args):
+    counts = [0] * TYPES
+    for _, label, _ in windows:
+        counts[label] += 1
+    majority = max(range(TYPES), key=lambda label: counts[label])
+    if depth < args.depth and counts[majority] < len(windows):
+        feature, threshold = bestSplit(windows, random.sample(range(len(FEATURES)), args.features), args.min_leaf)
+        if feature is not None:
+            left = [window for window in windows if window[0][feature] <= threshold]
+            right = [window for window in windows if window[0][feature] > threshold]
+            return ('node', feature, threshold, grow(left, depth + 1, args), grow(right, depth + 1, args))
+    return ('leaf', majority, max(1, round(100 * counts[majority] / len(windows))))
+
+
+# As classify() in forest.c: the most weight wins, ties go to the lower type
+def predict(forest, quantized):
+    votes = [0] * TYPES
+    for tree in forest:
+        while tree[0] == 'node':
+            tree = tree[3] if quantized[tree[1]] <= tree[2] else tree[4]
+        votes[tree[1]] += tree[2]
+    return max(range(TYPES), key=lambda label: (votes[label], -label))
+
+
+def accuracy(windows, pick):
+    return sum(1 for window in windows if pick(window) == window[1]) / len(windows)
+
+
+# Every tree in preorder, one node array for all of them
+def flatten(forest):
+    nodes = []
+    roots = []
+
+    def add(tree):
+        index = len(nodes)
+        nodes.append(None)
+        if tree[0] == 'leaf':
+            nodes[index] = ('FOREST_LEAF', tree[2], tree[1], 0)
+        else:
+            left = add(tree[3])
+            right = add(tree[4])
+            nodes[index] = (FEATURES[tree[1]], tree[2], left, right)
+        return index
+
+    for tree in forest:
+        roots.append(add(tree))
+    return roots, nodes
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Train the decision forest on forest_dump windows')
+    parser.add_argument('-t', dest='trees', type=int, default=5)
+    parser.add_argument('-d', dest='depth', type=int, default=4)
+    parser.add_argument('-f', dest='features', type=int, default=5, help='features tried per split')
+    parser.add_argument('-l', dest='min_leaf', type=int, default=20, help='fewest windows in a leaf')
+    parser.add_argument('-r', dest='seed', type=int, default=7)
+    parser.add_argument('-e', dest='test', action='append', default=[], help='held out dump')
+    parser.add_argument('train', nargs='+')
+    args = parser.parse_args()
+
+    random.seed(args.seed)
+    train = load(args.train)
+    forest = []
+    for _ in range(args.trees):
+        bootstrap = [random.choice(train) for _ in range(len(train))]
+        forest.append(grow(bootstrap, 0, args))
+    roots, nodes = flatten(forest)
+    if len(nodes) > 255:
+        sys.exit('%d nodes, ForestNode has 8 bit indices' % len(nodes))
+
+    print('#define FOREST_TREES\t%d' % len(roots))
+    print()
+    print('// Written by tools/forest_train.py, see tools/README.md. Thresholds are on the quantized values.')
+    print('static const uint8_t ROOTS[FOREST_TREES] = { %s };' % ', '.join(map(str, roots)))
+    print()
+    print('static const ForestNode NODES[] = {')
+    for index, node in enumerate(nodes):
+        line = '\t{ %s, %d, %d, %d }%s' % (node + (',' if index < len(nodes) - 1 else '',))
+        if index in roots:
+            line += '\t// Tree %d' % roots.index(index)
+        print(line)
+    print('};')
+
+    print('%d trees, %d nodes, %d training windows' % (len(roots), len(nodes), len(train)), file=sys.stderr)
+    if args.test:
+        test = load(args.test)
+        print('held out: %d windows, forest %.3f, classify() %.3f' % (len(test),
+                accuracy(test, lambda window: predict(forest, window[0])), accuracy(test, lambda window: window[2])),
+                file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
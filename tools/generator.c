@@ -0,0 +1,163 @@
+#include <math.h>
+#include "generator.h"
+
+#define DAY_MS		86400000ULL
+#define NIGHT_START	(23 * 3600000ULL)
+#define NIGHT_END	(7 * 3600000ULL)
+
+
+void defaultGeneratorConfig(GeneratorConfig* config) {
+	*config = (GeneratorConfig) {
+		.rate = 10,
+		.weights = { 1, 1, 1, 1, 1 },
+		.seconds = { 60, 400 },
+		.walkCadence = { 80, 125 },
+		.walkBounce = { 120, 400 },
+		.walkSwing = { 60, 250 },
+		.jogCadence = { 145, 185 },
+		.jogBounce = { 450, 1000 },
+		.jogSwing = { 250, 550 },
+		.vibration = { 15, 90 },
+		.fidget = { 0, 1 },
+		.gesture = { 40, 200 },
+		.tilt = { 0, M_PI / 2.2 },
+		.sleepTilt = { M_PI / 4, M_PI / 2 },
+		.noise = { 4, 16 },
+		.nights = false
+	};
+}
+
+
+// xorshift32, the same generator as the worker's synthetic module
+static double uniform(Generator* generator) {
+	generator->seed ^= generator->seed << 13;
+	generator->seed ^= generator->seed >> 17;
+	generator->seed ^= generator->seed << 5;
+	return (generator->seed % 1000000) / 1000000.0;
+}
+
+
+static double draw(Generator* generator, Range range) {
+	return range.low + (range.high - range.low) * uniform(generator);
+}
+
+
+static void startSegment(Generator* generator) {
+	const GeneratorConfig* config = &generator->config;
+	uint64_t timeOfDay = generator->timestamp % DAY_MS;
+	bool night = config->nights && (timeOfDay >= NIGHT_START || timeOfDay < NIGHT_END);
+
+	if (night) {
+		generator->label = GENERATOR_SLEEP;
+	} else {
+		uint32_t total = 0;
+		for (uint32_t i = 0; i < GENERATOR_TYPES; i++) {
+			total += config->weights[i];
+		}
+		uint32_t pick = (uint32_t) (uniform(generator) * total);
+		generator->label = 0;
+		while (pick >= config->weights[generator->label]) {
+			pick -= config->weights[generator->label];
+			generator->label++;
+		}
+	}
+
+	uint64_t samples = (uint64_t) (draw(generator, config->seconds) * config->rate);
+	if (night) {
+		// Lie still for longer, and wake up on time
+		samples *= 4;
+		uint64_t untilMorning = ((NIGHT_END + DAY_MS - timeOfDay) % DAY_MS) * config->rate / 1000;
+		if (samples > untilMorning)
+			samples = untilMorning > 0 ? untilMorning : 1;
+	} else if (config->nights) {
+		uint64_t untilNight = (NIGHT_START - timeOfDay) * config->rate / 1000;
+		if (samples > untilNight)
+			samples = untilNight > 0 ? untilNight : 1;
+	}
+	generator->remaining = (uint32_t) samples;
+
+	generator->cadence = generator->bounce = generator->swing = generator->vibration = generator->fidget = 0;
+	switch (generator->label) {
+		case GENERATOR_WALK:
+			generator->cadence = draw(generator, config->walkCadence);
+			generator->bounce = draw(generator, config->walkBounce);
+			generator->swing = draw(generator, config->walkSwing);
+			break;
+		case GENERATOR_JOG:
+			generator->cadence = draw(generator, config->jogCadence);
+			generator->bounce = draw(generator, config->jogBounce);
+			generator->swing = draw(generator, config->jogSwing);
+			break;
+		case GENERATOR_DRIVING:
+			generator->vibration = draw(generator, config->vibration);
+			break;
+		case GENERATOR_SIT:
+			generator->fidget = draw(generator, config->fidget);
+			break;
+	}
+
+	// A new segment, a new wrist orientation
+	double tilt = draw(generator, generator->label == GENERATOR_SLEEP ? config->sleepTilt : config->tilt);
+	generator->gravityY = 1000 * sin(tilt);
+	generator->gravityZ = -1000 * cos(tilt);
+	generator->noise = draw(generator, config->noise);
+	generator->gestureLeft = 0;
+}
+
+
+void initGenerator(Generator* generator, const GeneratorConfig* config, uint32_t seed, uint64_t timestamp) {
+	memset(generator, 0, sizeof(Generator));
+	generator->config = *config;
+	generator->seed = seed != 0 ? seed : 1;
+	generator->timestamp = timestamp;
+	startSegment(generator);
+}
+
+
+uint32_t generate(Generator* generator, AccelData* samples, uint64_t* steps, uint32_t size) {
+	if (generator->remaining == 0)
+		startSegment(generator);
+	if (size > generator->remaining)
+		size = generator->remaining;
+
+	double interval = 1000.0 / generator->config.rate;
+	double advance = 2 * M_PI * generator->cadence / 60 / generator->config.rate;
+	for (uint32_t i = 0; i < size; i++) {
+		// Vertical bounce once per step, arm swing once per stride
+		double v = 0;
+		double h = 0;
+		if (generator->cadence > 0) {
+			v = generator->bounce * sin(generator->phase);
+			h = generator->swing * sin(generator->phase / 2);
+			double phase = generator->phase + advance;
+			generator->steps += (uint64_t) (phase / (2 * M_PI)) - (uint64_t) (generator->phase / (2 * M_PI));
+			generator->phase = phase >= 4 * M_PI ? phase - 4 * M_PI : phase;
+		}
+		v += generator->vibration * (2 * uniform(generator) - 1);
+
+		// Sitting still, apart from the odd gesture
+		if (generator->fidget > 0) {
+			if (generator->gestureLeft == 0 && uniform(generator) < generator->fidget / 100) {
+				generator->gestureLeft = (uint32_t) draw(generator, (Range) { 5, 30 });
+				generator->gesture = draw(generator, generator->config.gesture);
+			}
+			if (generator->gestureLeft > 0) {
+				generator->gestureLeft--;
+				v += generator->gesture * sin(generator->gestureLeft * 0.7);
+				h += generator->gesture * 0.7 * cos(generator->gestureLeft * 0.5);
+			}
+		}
+
+		double noise = generator->noise;
+		samples[i].x = (int16_t) (h + noise * (2 * uniform(generator) - 1));
+		samples[i].y = (int16_t) (generator->gravityY + v * generator->gravityY / 1000 + noise * (2 * uniform(generator) - 1));
+		samples[i].z = (int16_t) (generator->gravityZ + v * generator->gravityZ / 1000 + noise * (2 * uniform(generator) - 1));
+		samples[i].did_vibrate = false;
+		samples[i].timestamp = generator->timestamp + (uint64_t) (i * interval);
+		if (steps != NULL)
+			steps[i] = generator->steps;
+	}
+	generator->timestamp += (uint64_t) (size * interval);
+	generator->remaining -= size;
+	return size;
+}
@@ -0,0 +1,66 @@
+#ifndef _GENERATOR_H_
+#define _GENERATOR_H_
+
+#include "pebble_worker.h"
+
+// Activity types, as the worker numbers them
+enum { GENERATOR_SLEEP, GENERATOR_SIT, GENERATOR_WALK, GENERATOR_JOG, GENERATOR_DRIVING, GENERATOR_TYPES };
+
+typedef struct {
+	double low;
+	double high;
+} Range;
+
+/*
+ * What the generated traces look like. Every segment draws its parameters uniformly from these ranges, so
+ * a seed picks one of endless people, wrists and cars instead of replaying one fixed day.
+ */
+typedef struct {
+	uint32_t rate;	// Samples per second
+	uint32_t weights[GENERATOR_TYPES];	// How often each type is picked in the daytime
+	Range seconds;	// Segment length
+	Range walkCadence;	// Steps per minute
+	Range walkBounce;	// Vertical amplitude per step, mG
+	Range walkSwing;	// Arm swing amplitude per stride, mG
+	Range jogCadence;
+	Range jogBounce;
+	Range jogSwing;
+	Range vibration;	// Vehicle vibration amplitude, mG
+	Range fidget;	// Odds of a wrist gesture per sample while sitting, in percent
+	Range gesture;	// Gesture amplitude, mG
+	Range tilt;	// Angle of gravity away from -z, radians
+	Range sleepTilt;	// The same lying down
+	Range noise;	// Sensor noise amplitude, mG
+	bool nights;	// Sleep from 23:00 to 7:00 UTC, turning over now and then
+} GeneratorConfig;
+
+typedef struct {
+	GeneratorConfig config;
+	uint32_t seed;
+	uint64_t timestamp;	// Of the next sample, ms
+
+	// Current segment
+	uint32_t label;
+	uint32_t remaining;	// Samples
+	double cadence;
+	double bounce;
+	double swing;
+	double vibration;
+	double fidget;
+	double noise;
+	double gravityY;
+	double gravityZ;
+	double phase;	// 2 pi per step, wraps after a stride
+	double gesture;
+	uint32_t gestureLeft;
+
+	uint64_t steps;	// Ground truth so far
+} Generator;
+
+void defaultGeneratorConfig(GeneratorConfig* config);
+void initGenerator(Generator* generator, const GeneratorConfig* config, uint32_t seed, uint64_t timestamp);
+// Up to size samples, all from one segment so generator->label holds for every one of them. steps, if not
+// NULL, gets the ground truth after each sample.
+uint32_t generate(Generator* generator, AccelData* samples, uint64_t* steps, uint32_t size);
+
+#endif
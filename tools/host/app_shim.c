@@ -0,0 +1,803 @@
+#include <stdarg.h>
+#include "pebble.h"
+#include "host.h"
+
+#define HOST_TIMERS	16
+
+struct HostFont {
+	const char* key;
+	int16_t height;
+};
+
+struct GBitmap {
+	GRect bounds;
+};
+
+struct GContext {
+	GColor fill;
+	GColor text;
+};
+
+struct Layer {
+	GRect frame;
+	GRect bounds;
+	LayerUpdateProc update;
+	Layer* parent;
+	Layer* child;	// First child, drawn first
+	Layer* sibling;
+	bool hidden;
+};
+
+struct TextLayer {
+	Layer layer;	// First, the layer's update procedure casts back
+	const char* text;
+	GFont font;
+	GTextAlignment alignment;
+	GColor color;
+	GColor background;
+};
+
+struct BitmapLayer {
+	Layer layer;
+	const GBitmap* bitmap;
+	GAlign alignment;
+};
+
+struct InverterLayer {
+	Layer layer;
+};
+
+struct Window {
+	Layer* root;
+	WindowHandlers handlers;
+	bool loaded;
+};
+
+struct AppTimer {
+	uint64_t due;	// Simulated ms, 0 when the slot is free
+	AppTimerCallback callback;
+	void* data;
+};
+
+static TickHandler mTickHandler = NULL;
+static TimeUnits mTickUnits = 0;
+static AccelTapHandler mTapHandler = NULL;
+static BatteryStateHandler mBatteryHandler = NULL;
+static AppWorkerMessageHandler mWorkerMessageHandler = NULL;
+static HostMessageHook mMessageHook = NULL;
+static BluetoothConnectionHandler mBluetoothHandler = NULL;
+
+static Window* mTopWindow = NULL;
+static bool mDirty = false;
+static struct GContext mContext;
+static HostUiCounters mCounters;
+static struct AppTimer mTimers[HOST_TIMERS];
+
+static AppMessageInboxReceived mInboxReceived = NULL;
+static AppMessageInboxDropped mInboxDropped = NULL;
+static AppMessageOutboxSent mOutboxSent = NULL;
+static AppMessageOutboxFailed mOutboxFailed = NULL;
+static HostOutboxHook mOutboxHook = NULL;
+static uint8_t* mOutbox = NULL;
+static uint32_t mOutboxSize = 0;
+static uint32_t mInboxSize = 0;
+static DictionaryIterator mOutboxIterator;
+static bool mOutboxBusy = false;	// Begun or in flight
+static bool mOutboxPending = false;	// Sent, waiting for the phone
+
+
+void app_shim_tick_timer_service_subscribe(TimeUnits units, TickHandler handler) {
+	mTickUnits = units;
+	mTickHandler = handler;
+}
+
+
+void app_shim_tick_timer_service_unsubscribe(void) {
+	mTickHandler = NULL;
+}
+
+
+TickHandler hostAppTickHandler() {
+	return mTickHandler;
+}
+
+
+TimeUnits hostAppTickUnits() {
+	return mTickUnits;
+}
+
+
+void app_shim_accel_tap_service_subscribe(AccelTapHandler handler) {
+	mTapHandler = handler;
+}
+
+
+void app_shim_accel_tap_service_unsubscribe(void) {
+	mTapHandler = NULL;
+}
+
+
+AccelTapHandler hostAppTapHandler() {
+	return mTapHandler;
+}
+
+
+void app_shim_battery_state_service_subscribe(BatteryStateHandler handler) {
+	mBatteryHandler = handler;
+}
+
+
+void app_shim_battery_state_service_unsubscribe(void) {
+	mBatteryHandler = NULL;
+}
+
+
+BatteryStateHandler hostAppBatteryHandler() {
+	return mBatteryHandler;
+}
+
+
+int app_shim_app_worker_send_message(uint8_t type, AppWorkerMessage* data) {
+	if (mMessageHook != NULL)
+		mMessageHook(type, data);
+	return 0;
+}
+
+
+bool app_shim_app_worker_message_subscribe(AppWorkerMessageHandler handler) {
+	mWorkerMessageHandler = handler;
+	return true;
+}
+
+
+bool app_shim_app_worker_message_unsubscribe(void) {
+	mWorkerMessageHandler = NULL;
+	return true;
+}
+
+
+AppWorkerMessageHandler hostAppWorkerMessageHandler() {
+	return mWorkerMessageHandler;
+}
+
+
+void hostSetAppMessageHook(HostMessageHook hook) {
+	mMessageHook = hook;
+}
+
+
+// The host starts the worker itself, before the app
+AppWorkerResult app_worker_launch(void) {
+	return APP_WORKER_RESULT_ALREADY_RUNNING;
+}
+
+
+// The host drives the events itself, see host.h
+void app_event_loop(void) {
+}
+
+
+bool clock_is_24h_style(void) {
+	return true;
+}
+
+
+void bluetooth_connection_service_subscribe(BluetoothConnectionHandler handler) {
+	mBluetoothHandler = handler;
+}
+
+
+void bluetooth_connection_service_unsubscribe(void) {
+	mBluetoothHandler = NULL;
+}
+
+
+bool bluetooth_connection_service_peek(void) {
+	return true;
+}
+
+
+void vibes_short_pulse(void) {
+}
+
+
+void vibes_double_pulse(void) {
+}
+
+
+GPoint grect_center_point(const GRect* rect) {
+	return GPoint(rect->origin.x + rect->size.w / 2, rect->origin.y + rect->size.h / 2);
+}
+
+
+// One font per key, with the point size taken from its trailing digits
+GFont fonts_get_system_font(const char* key) {
+	static struct HostFont fonts[8];
+	static uint32_t count = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		if (strcmp(fonts[i].key, key) == 0)
+			return &fonts[i];
+	}
+	if (count == sizeof(fonts) / sizeof(fonts[0])) {
+		fprintf(stderr, "fonts_get_system_font: too many fonts\n");
+		abort();
+	}
+	const char* digits = key + strcspn(key, "0123456789");
+	fonts[count].key = key;
+	fonts[count].height = *digits != '\0' ? (int16_t) atoi(digits) : 18;
+	return &fonts[count++];
+}
+
+
+GBitmap* gbitmap_create_with_resource(uint32_t resourceId) {
+	GBitmap* bitmap = malloc(sizeof(GBitmap));
+	bitmap->bounds = GRect(0, 0, 144, 168);
+	return bitmap;
+}
+
+
+GBitmap* gbitmap_create_as_sub_bitmap(const GBitmap* parent, GRect rect) {
+	GBitmap* bitmap = malloc(sizeof(GBitmap));
+	bitmap->bounds = rect;
+	return bitmap;
+}
+
+
+void gbitmap_destroy(GBitmap* bitmap) {
+	free(bitmap);
+}
+
+
+void graphics_context_set_fill_color(GContext* context, GColor color) {
+	context->fill = color;
+}
+
+
+void graphics_context_set_text_color(GContext* context, GColor color) {
+	context->text = color;
+}
+
+
+void graphics_fill_rect(GContext* context, GRect rect, uint16_t radius, GCornerMask corners) {
+	mCounters.drawCalls++;
+}
+
+
+void graphics_draw_bitmap_in_rect(GContext* context, const GBitmap* bitmap, GRect rect) {
+	mCounters.drawCalls++;
+}
+
+
+void graphics_draw_text(GContext* context, const char* text, GFont font, GRect box, GTextOverflowMode overflow,
+		GTextAlignment alignment, GTextAttributes* attributes) {
+	mCounters.drawCalls++;
+}
+
+
+// Glyphs are taken as half as wide as the font is tall, on one line
+GSize graphics_text_layout_get_content_size(const char* text, GFont font, GRect box, GTextOverflowMode overflow,
+		GTextAlignment alignment) {
+	int32_t width = (int32_t) strlen(text) * font->height / 2;
+	return GSize((int16_t) (width < box.size.w ? width : box.size.w), font->height);
+}
+
+
+static void initLayer(Layer* layer, GRect frame) {
+	memset(layer, 0, sizeof(Layer));
+	layer->frame = frame;
+	layer->bounds = GRect(0, 0, frame.size.w, frame.size.h);
+}
+
+
+Layer* layer_create(GRect frame) {
+	Layer* layer = malloc(sizeof(Layer));
+	initLayer(layer, frame);
+	return layer;
+}
+
+
+void layer_destroy(Layer* layer) {
+	if (layer == NULL)
+		return;
+	layer_remove_from_parent(layer);
+	free(layer);
+}
+
+
+void layer_set_update_proc(Layer* layer, LayerUpdateProc update) {
+	layer->update = update;
+}
+
+
+// Any dirty layer redraws the whole window, as on the watch
+void layer_mark_dirty(Layer* layer) {
+	mCounters.dirtyMarks++;
+	mDirty = true;
+}
+
+
+GRect layer_get_frame(const Layer* layer) {
+	return layer->frame;
+}
+
+
+GRect layer_get_bounds(const Layer* layer) {
+	return layer->bounds;
+}
+
+
+void layer_add_child(Layer* parent, Layer* child) {
+	layer_remove_from_parent(child);
+	child->parent = parent;
+	Layer** last = &parent->child;
+	while (*last != NULL)
+		last = &(*last)->sibling;
+	*last = child;
+	layer_mark_dirty(parent);
+}
+
+
+void layer_remove_from_parent(Layer* child) {
+	if (child->parent == NULL)
+		return;
+	for (Layer** link = &child->parent->child; *link != NULL; link = &(*link)->sibling) {
+		if (*link == child) {
+			*link = child->sibling;
+			break;
+		}
+	}
+	layer_mark_dirty(child->parent);
+	child->parent = NULL;
+	child->sibling = NULL;
+}
+
+
+void layer_set_hidden(Layer* layer, bool hidden) {
+	if (layer->hidden == hidden)
+		return;
+	layer->hidden = hidden;
+	layer_mark_dirty(layer);
+}
+
+
+static void drawText(Layer* layer, GContext* context) {
+	TextLayer* text = (TextLayer*) layer;
+	graphics_context_set_fill_color(context, text->background);
+	graphics_fill_rect(context, layer->bounds, 0, GCornerNone);
+	if (text->text != NULL) {
+		graphics_context_set_text_color(context, text->color);
+		graphics_draw_text(context, text->text, text->font, layer->bounds, GTextOverflowModeWordWrap, text->alignment, NULL);
+	}
+}
+
+
+TextLayer* text_layer_create(GRect frame) {
+	TextLayer* layer = malloc(sizeof(TextLayer));
+	memset(layer, 0, sizeof(TextLayer));
+	initLayer(&layer->layer, frame);
+	layer->layer.update = drawText;
+	layer->font = fonts_get_system_font(FONT_KEY_GOTHIC_14_BOLD);
+	layer->color = GColorBlack;
+	layer->background = GColorWhite;
+	return layer;
+}
+
+
+void text_layer_destroy(TextLayer* layer) {
+	if (layer == NULL)
+		return;
+	layer_remove_from_parent(&layer->layer);
+	free(layer);
+}
+
+
+Layer* text_layer_get_layer(TextLayer* layer) {
+	return &layer->layer;
+}
+
+
+// The SDK marks the layer dirty on every setter, changed or not
+void text_layer_set_text(TextLayer* layer, const char* text) {
+	layer->text = text;
+	layer_mark_dirty(&layer->layer);
+}
+
+
+void text_layer_set_font(TextLayer* layer, GFont font) {
+	layer->font = font;
+	layer_mark_dirty(&layer->layer);
+}
+
+
+void text_layer_set_text_alignment(TextLayer* layer, GTextAlignment alignment) {
+	layer->alignment = alignment;
+	layer_mark_dirty(&layer->layer);
+}
+
+
+void text_layer_set_text_color(TextLayer* layer, GColor color) {
+	layer->color = color;
+	layer_mark_dirty(&layer->layer);
+}
+
+
+void text_layer_set_background_color(TextLayer* layer, GColor color) {
+	layer->background = color;
+	layer_mark_dirty(&layer->layer);
+}
+
+
+static void drawBitmap(Layer* layer, GContext* context) {
+	BitmapLayer* bitmap = (BitmapLayer*) layer;
+	if (bitmap->bitmap != NULL)
+		graphics_draw_bitmap_in_rect(context, bitmap->bitmap, layer->bounds);
+}
+
+
+BitmapLayer* bitmap_layer_create(GRect frame) {
+	BitmapLayer* layer = malloc(sizeof(BitmapLayer));
+	memset(layer, 0, sizeof(BitmapLayer));
+	initLayer(&layer->layer, frame);
+	layer->layer.update = drawBitmap;
+	return layer;
+}
+
+
+void bitmap_layer_destroy(BitmapLayer* layer) {
+	if (layer == NULL)
+		return;
+	layer_remove_from_parent(&layer->layer);
+	free(layer);
+}
+
+
+Layer* bitmap_layer_get_layer(BitmapLayer* layer) {
+	return &layer->layer;
+}
+
+
+void bitmap_layer_set_bitmap(BitmapLayer* layer, const GBitmap* bitmap) {
+	layer->bitmap = bitmap;
+	layer_mark_dirty(&layer->layer);
+}
+
+
+void bitmap_layer_set_alignment(BitmapLayer* layer, GAlign alignment) {
+	layer->alignment = alignment;
+	layer_mark_dirty(&layer->layer);
+}
+
+
+// Inverting the frame buffer is one pass over it
+static void drawInverter(Layer* layer, GContext* context) {
+	mCounters.drawCalls++;
+}
+
+
+InverterLayer* inverter_layer_create(GRect frame) {
+	InverterLayer* layer = malloc(sizeof(InverterLayer));
+	initLayer(&layer->layer, frame);
+	layer->layer.update = drawInverter;
+	return layer;
+}
+
+
+void inverter_layer_destroy(InverterLayer* layer) {
+	if (layer == NULL)
+		return;
+	layer_remove_from_parent(&layer->layer);
+	free(layer);
+}
+
+
+Layer* inverter_layer_get_layer(InverterLayer* layer) {
+	return &layer->layer;
+}
+
+
+Window* window_create(void) {
+	Window* window = malloc(sizeof(Window));
+	memset(window, 0, sizeof(Window));
+	window->root = layer_create(GRect(0, 0, 144, 168));
+	return window;
+}
+
+
+void window_destroy(Window* window) {
+	if (window == NULL)
+		return;
+	if (window->loaded && window->handlers.unload != NULL)
+		window->handlers.unload(window);
+	if (mTopWindow == window)
+		mTopWindow = NULL;
+	// Whatever the app left on the root layer is the app's to free, unhook it first
+	while (window->root->child != NULL)
+		layer_remove_from_parent(window->root->child);
+	free(window->root);
+	free(window);
+}
+
+
+void window_set_window_handlers(Window* window, WindowHandlers handlers) {
+	window->handlers = handlers;
+}
+
+
+Layer* window_get_root_layer(const Window* window) {
+	return window->root;
+}
+
+
+// One window at a time is all the watchfaces need
+void window_stack_push(Window* window, bool animated) {
+	mTopWindow = window;
+	if (!window->loaded) {
+		window->loaded = true;
+		if (window->handlers.load != NULL)
+			window->handlers.load(window);
+	}
+	if (window->handlers.appear != NULL)
+		window->handlers.appear(window);
+	layer_mark_dirty(window->root);
+}
+
+
+static void drawLayer(Layer* layer) {
+	if (layer->hidden)
+		return;
+	mCounters.layersDrawn++;
+	if (layer->update != NULL)
+		layer->update(layer, &mContext);
+	for (Layer* child = layer->child; child != NULL; child = child->sibling)
+		drawLayer(child);
+}
+
+
+bool hostRender() {
+	if (!mDirty || mTopWindow == NULL)
+		return false;
+	mDirty = false;
+	mCounters.redraws++;
+	drawLayer(mTopWindow->root);
+	return true;
+}
+
+
+const HostUiCounters* hostUiCounters() {
+	return &mCounters;
+}
+
+
+AppTimer* app_timer_register(uint32_t timeoutMs, AppTimerCallback callback, void* data) {
+	for (uint32_t i = 0; i < HOST_TIMERS; i++) {
+		if (mTimers[i].due == 0) {
+			mTimers[i] = (struct AppTimer) { hostNow() + (timeoutMs > 0 ? timeoutMs : 1), callback, data };
+			return &mTimers[i];
+		}
+	}
+	fprintf(stderr, "app_timer_register: more than %d timers\n", HOST_TIMERS);
+	abort();
+}
+
+
+void app_timer_cancel(AppTimer* timer) {
+	if (timer != NULL)
+		timer->due = 0;
+}
+
+
+uint32_t hostFireTimers() {
+	uint32_t fired = 0;
+	for (uint32_t i = 0; i < HOST_TIMERS; i++) {
+		if (mTimers[i].due != 0 && mTimers[i].due <= hostNow()) {
+			struct AppTimer timer = mTimers[i];
+			mTimers[i].due = 0;
+			timer.callback(timer.data);
+			fired++;
+		}
+	}
+	return fired;
+}
+
+
+uint32_t dict_calc_buffer_size(uint8_t count, ...) {
+	uint32_t size = sizeof(Dictionary) + count * sizeof(Tuple);
+	va_list args;
+	va_start(args, count);
+	for (uint8_t i = 0; i < count; i++) {
+		size += va_arg(args, uint32_t);
+	}
+	va_end(args);
+	return size;
+}
+
+
+uint32_t dict_size(DictionaryIterator* iter) {
+	return (uint32_t) ((const uint8_t*) iter->end - (const uint8_t*) iter->dictionary);
+}
+
+
+static void dictBegin(DictionaryIterator* iter, uint8_t* buffer) {
+	iter->dictionary = (Dictionary*) buffer;
+	iter->dictionary->count = 0;
+	iter->cursor = iter->dictionary->head;
+	iter->end = iter->cursor;
+}
+
+
+Tuple* dict_find(const DictionaryIterator* iter, uint32_t key) {
+	Tuple* tuple = iter->dictionary->head;
+	for (uint8_t i = 0; i < iter->dictionary->count; i++) {
+		if (tuple->key == key)
+			return tuple;
+		tuple = (Tuple*) ((uint8_t*) tuple + sizeof(Tuple) + tuple->length);
+	}
+	return NULL;
+}
+
+
+static DictionaryResult dictWrite(DictionaryIterator* iter, uint32_t key, TupleType type, const void* data, uint16_t size) {
+	uint8_t* at = (uint8_t*) iter->cursor;
+	if (iter->dictionary == (Dictionary*) mOutbox && at + sizeof(Tuple) + size > mOutbox + mOutboxSize)
+		return DICT_NOT_ENOUGH_STORAGE;
+	Tuple* tuple = iter->cursor;
+	tuple->key = key;
+	tuple->type = (uint8_t) type;
+	tuple->length = size;
+	memcpy(tuple->value, data, size);
+	iter->dictionary->count++;
+	iter->cursor = (Tuple*) (at + sizeof(Tuple) + size);
+	iter->end = iter->cursor;
+	return DICT_OK;
+}
+
+
+DictionaryResult dict_write_tuplet(DictionaryIterator* iter, const Tuplet* tuplet) {
+	switch (tuplet->type) {
+		case TUPLE_BYTE_ARRAY:
+			return dictWrite(iter, tuplet->key, tuplet->type, tuplet->bytes.data, tuplet->bytes.length);
+		case TUPLE_CSTRING:
+			return dictWrite(iter, tuplet->key, tuplet->type, tuplet->cstring.data, tuplet->cstring.length);
+		default:
+			// Little endian: the low bytes of the storage are the value at its width
+			return dictWrite(iter, tuplet->key, tuplet->type, &tuplet->integer.storage, tuplet->integer.width);
+	}
+}
+
+
+DictionaryResult dict_write_uint32(DictionaryIterator* iter, uint32_t key, uint32_t value) {
+	return dictWrite(iter, key, TUPLE_UINT, &value, sizeof(value));
+}
+
+
+DictionaryResult dict_write_data(DictionaryIterator* iter, uint32_t key, const uint8_t* data, uint16_t size) {
+	return dictWrite(iter, key, TUPLE_BYTE_ARRAY, data, size);
+}
+
+
+AppMessageResult app_message_open(uint32_t inboxSize, uint32_t outboxSize) {
+	free(mOutbox);
+	mOutbox = malloc(outboxSize);
+	mOutboxSize = outboxSize;
+	mInboxSize = inboxSize;
+	mOutboxBusy = false;
+	mOutboxPending = false;
+	return APP_MSG_OK;
+}
+
+
+// Aplite's limit; the exporter caps it at EXPORT_OUTBOX_MAX anyway
+uint32_t app_message_outbox_size_maximum(void) {
+	return 656;
+}
+
+
+AppMessageInboxReceived app_message_register_inbox_received(AppMessageInboxReceived callback) {
+	AppMessageInboxReceived previous = mInboxReceived;
+	mInboxReceived = callback;
+	return previous;
+}
+
+
+AppMessageInboxDropped app_message_register_inbox_dropped(AppMessageInboxDropped callback) {
+	AppMessageInboxDropped previous = mInboxDropped;
+	mInboxDropped = callback;
+	return previous;
+}
+
+
+AppMessageOutboxSent app_message_register_outbox_sent(AppMessageOutboxSent callback) {
+	AppMessageOutboxSent previous = mOutboxSent;
+	mOutboxSent = callback;
+	return previous;
+}
+
+
+AppMessageOutboxFailed app_message_register_outbox_failed(AppMessageOutboxFailed callback) {
+	AppMessageOutboxFailed previous = mOutboxFailed;
+	mOutboxFailed = callback;
+	return previous;
+}
+
+
+void app_message_deregister_callbacks(void) {
+	mInboxReceived = NULL;
+	mInboxDropped = NULL;
+	mOutboxSent = NULL;
+	mOutboxFailed = NULL;
+}
+
+
+AppMessageResult app_message_outbox_begin(DictionaryIterator** iterator) {
+	if (mOutbox == NULL)
+		return APP_MSG_CLOSED;
+	if (mOutboxBusy)
+		return APP_MSG_BUSY;
+	mOutboxBusy = true;
+	dictBegin(&mOutboxIterator, mOutbox);
+	*iterator = &mOutboxIterator;
+	return APP_MSG_OK;
+}
+
+
+AppMessageResult app_message_outbox_send(void) {
+	if (!mOutboxBusy || mOutboxPending)
+		return APP_MSG_INVALID_ARGS;
+	mOutboxPending = true;
+	if (mOutboxHook != NULL)
+		mOutboxHook(mOutbox, dict_size(&mOutboxIterator));
+	return APP_MSG_OK;
+}
+
+
+void hostSetOutboxHook(HostOutboxHook hook) {
+	mOutboxHook = hook;
+}
+
+
+bool hostOutboxPending() {
+	return mOutboxPending;
+}
+
+
+void hostOutboxDone(bool delivered) {
+	if (!mOutboxPending)
+		return;
+	mOutboxPending = false;
+	mOutboxBusy = false;
+	if (delivered && mOutboxSent != NULL) {
+		mOutboxSent(&mOutboxIterator, NULL);
+	} else if (!delivered && mOutboxFailed != NULL) {
+		mOutboxFailed(&mOutboxIterator, APP_MSG_SEND_TIMEOUT, NULL);
+	}
+}
+
+
+bool hostPhoneSend(const uint32_t* keys, const int32_t* values, uint32_t count) {
+	uint8_t buffer[mInboxSize > 0 ? mInboxSize : 1];
+	DictionaryIterator iter;
+	dictBegin(&iter, buffer);
+	if (dict_calc_buffer_size(0) + count * (sizeof(Tuple) + sizeof(int32_t)) > mInboxSize) {
+		if (mInboxDropped != NULL)
+			mInboxDropped(APP_MSG_BUFFER_OVERFLOW, NULL);
+		return false;
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		dictWrite(&iter, keys[i], TUPLE_INT, &values[i], sizeof(int32_t));
+	}
+	if (mInboxReceived == NULL)
+		return false;
+	mInboxReceived(&iter, NULL);
+	return true;
+}
+
+
+bool hostDictInt(const uint8_t* data, uint32_t size, uint32_t key, int32_t* value) {
+	DictionaryIterator iter = { (Dictionary*) data, data + size, NULL };
+	Tuple* tuple = dict_find(&iter, key);
+	if (tuple == NULL || tuple->length > sizeof(int32_t))
+		return false;
+	*value = 0;
+	memcpy(value, tuple->value, tuple->length);
+	return true;
+}
@@ -0,0 +1,79 @@
+#ifndef _HOST_H_
+#define _HOST_H_
+
+#include "pebble_worker.h"
+
+/*
+ * Control side of the shim: the simulated clock, the services' subscribers and hooks on what the code
+ * under test sends out. All of it is process-global, like the watch, so one process runs one worker.
+ * The pure pipeline (recognizer, filter, classifier) needs none of it and can run on many threads.
+ */
+
+#define HOST_PERSIST_KEYS	64
+
+// Clock, in milliseconds since the epoch
+void hostSetTime(uint64_t milliseconds);
+uint64_t hostNow();
+
+// Subscribers, NULL when nothing is subscribed
+AccelDataHandler hostAccelHandler();
+uint32_t hostAccelBatchSize();
+AccelTapHandler hostTapHandler();
+TickHandler hostTickHandler();
+TimeUnits hostTickUnits();
+BatteryStateHandler hostBatteryHandler();
+void hostSetBattery(BatteryChargeState state);
+
+// Hooks on what goes out; NULL drops it. Worker messages are counted either way.
+typedef void (*HostMessageHook)(uint8_t type, AppWorkerMessage* data);
+typedef void (*HostDataLogHook)(uint32_t tag, const uint8_t* data, uint32_t itemLength, uint32_t numItems);
+void hostSetMessageHook(HostMessageHook hook);
+AppWorkerMessageHandler hostWorkerMessageHandler();
+void hostSetDataLogHook(HostDataLogHook hook);
+
+// Persistent storage, kept in memory. Writes are counted. Save and load carry it across processes, the way
+// it outlives a killed worker on the watch.
+void hostClearPersist();
+uint32_t hostPersistWrites();
+bool hostSavePersist(const char* path);
+bool hostLoadPersist(const char* path);
+
+// APP_LOG lines at or below this level are printed to stderr, none by default
+void hostSetLogLevel(uint8_t level);
+
+/*
+ * The watchface's side, in app_shim.c, for a host that runs the app next to the worker. The app has its
+ * own subscribers for the services both of them use. What the app sends the worker goes through its own
+ * message hook; the host hands it to hostWorkerMessageHandler() and the worker's messages to
+ * hostAppWorkerMessageHandler().
+ */
+TickHandler hostAppTickHandler();
+TimeUnits hostAppTickUnits();
+AccelTapHandler hostAppTapHandler();
+BatteryStateHandler hostAppBatteryHandler();
+AppWorkerMessageHandler hostAppWorkerMessageHandler();
+void hostSetAppMessageHook(HostMessageHook hook);
+
+// Renders the window once if anything was marked dirty since the last frame
+typedef struct {
+	uint32_t dirtyMarks;	// layer_mark_dirty calls, the ones the SDK's setters make included
+	uint32_t redraws;	// Frames
+	uint32_t layersDrawn;
+	uint32_t drawCalls;
+} HostUiCounters;
+bool hostRender();
+const HostUiCounters* hostUiCounters();
+
+// Runs the app timers that are due on the simulated clock
+uint32_t hostFireTimers();
+
+// AppMessage with the phone: the hook sees each outgoing dictionary, which stays in flight until the host
+// reports it delivered or failed. The phone sends dictionaries of integers.
+typedef void (*HostOutboxHook)(const uint8_t* data, uint32_t size);
+void hostSetOutboxHook(HostOutboxHook hook);
+bool hostOutboxPending();
+void hostOutboxDone(bool delivered);
+bool hostPhoneSend(const uint32_t* keys, const int32_t* values, uint32_t count);
+bool hostDictInt(const uint8_t* data, uint32_t size, uint32_t key, int32_t* value);
+
+#endif
@@ -0,0 +1,304 @@
+#ifndef _PEBBLE_H_
+#define _PEBBLE_H_
+
+/*
+ * Host stand-in for the SDK's app header, for the watchface: the worker's part of the API plus windows,
+ * layers, graphics, AppMessage and timers. The app's half is implemented in app_shim.c and driven from
+ * host.h. Nothing is drawn; layers keep their frames and the renderer only counts what it would draw.
+ */
+#include "pebble_worker.h"
+
+#ifdef TREE_Basalt
+#define PBL_COLOR
+#endif
+
+// The watchface runs next to the worker in the same process, so it gets its own side of the services
+// they both use, and its worker messages go the other way
+#define tick_timer_service_subscribe	app_shim_tick_timer_service_subscribe
+#define tick_timer_service_unsubscribe	app_shim_tick_timer_service_unsubscribe
+#define accel_tap_service_subscribe	app_shim_accel_tap_service_subscribe
+#define accel_tap_service_unsubscribe	app_shim_accel_tap_service_unsubscribe
+#define battery_state_service_subscribe	app_shim_battery_state_service_subscribe
+#define battery_state_service_unsubscribe	app_shim_battery_state_service_unsubscribe
+#define app_worker_send_message	app_shim_app_worker_send_message
+#define app_worker_message_subscribe	app_shim_app_worker_message_subscribe
+#define app_worker_message_unsubscribe	app_shim_app_worker_message_unsubscribe
+
+void tick_timer_service_subscribe(TimeUnits units, TickHandler handler);
+void tick_timer_service_unsubscribe(void);
+void accel_tap_service_subscribe(AccelTapHandler handler);
+void accel_tap_service_unsubscribe(void);
+void battery_state_service_subscribe(BatteryStateHandler handler);
+void battery_state_service_unsubscribe(void);
+int app_worker_send_message(uint8_t type, AppWorkerMessage* data);
+bool app_worker_message_subscribe(AppWorkerMessageHandler handler);
+bool app_worker_message_unsubscribe(void);
+
+typedef enum {
+	APP_WORKER_RESULT_SUCCESS = 0,
+	APP_WORKER_RESULT_NO_WORKER = 1,
+	APP_WORKER_RESULT_DIFFERENT_APP = 2,
+	APP_WORKER_RESULT_NOT_RUNNING = 3,
+	APP_WORKER_RESULT_ALREADY_RUNNING = 4,
+	APP_WORKER_RESULT_ASKING_CONFIRMATION = 5
+} AppWorkerResult;
+AppWorkerResult app_worker_launch(void);
+void app_event_loop(void);
+bool clock_is_24h_style(void);
+
+// Geometry and colors
+typedef struct {
+	int16_t x;
+	int16_t y;
+} GPoint;
+typedef struct {
+	int16_t w;
+	int16_t h;
+} GSize;
+typedef struct {
+	GPoint origin;
+	GSize size;
+} GRect;
+#define GPoint(x, y)	((GPoint) { (x), (y) })
+#define GSize(w, h)	((GSize) { (w), (h) })
+#define GRect(x, y, w, h)	((GRect) { { (x), (y) }, { (w), (h) } })
+GPoint grect_center_point(const GRect* rect);
+
+typedef struct {
+	uint8_t argb;
+} GColor8;
+typedef GColor8 GColor;
+#define GColorClear	((GColor8) { 0x00 })
+#define GColorBlack	((GColor8) { 0xc0 })
+#define GColorWhite	((GColor8) { 0xff })
+#define GColorRed	((GColor8) { 0xf0 })
+#define GColorOrange	((GColor8) { 0xf8 })
+#define GColorRajah	((GColor8) { 0xf9 })
+#define GColorGreen	((GColor8) { 0xcc })
+#define GColorMintGreen	((GColor8) { 0xee })
+#define GColorCyan	((GColor8) { 0xcf })
+
+typedef enum {
+	GCornerNone = 0,
+	GCornerTopLeft = 1 << 0,
+	GCornerTopRight = 1 << 1,
+	GCornerBottomLeft = 1 << 2,
+	GCornerBottomRight = 1 << 3,
+	GCornersAll = 0x0f
+} GCornerMask;
+
+typedef enum {
+	GAlignCenter,
+	GAlignTopLeft,
+	GAlignTopRight,
+	GAlignTop,
+	GAlignLeft,
+	GAlignBottom,
+	GAlignRight,
+	GAlignBottomRight,
+	GAlignBottomLeft
+} GAlign;
+
+typedef enum {
+	GTextAlignmentLeft,
+	GTextAlignmentCenter,
+	GTextAlignmentRight
+} GTextAlignment;
+
+typedef enum {
+	GTextOverflowModeWordWrap,
+	GTextOverflowModeTrailingEllipsis,
+	GTextOverflowModeFill
+} GTextOverflowMode;
+
+typedef struct GTextAttributes GTextAttributes;
+
+// Fonts: the size is read off the key
+typedef const struct HostFont* GFont;
+#define FONT_KEY_GOTHIC_14_BOLD	"RESOURCE_ID_GOTHIC_14_BOLD"
+#define FONT_KEY_GOTHIC_18_BOLD	"RESOURCE_ID_GOTHIC_18_BOLD"
+#define FONT_KEY_ROBOTO_BOLD_SUBSET_49	"RESOURCE_ID_ROBOTO_BOLD_SUBSET_49"
+#define FONT_KEY_LECO_20_BOLD_NUMBERS	"RESOURCE_ID_LECO_20_BOLD_NUMBERS"
+#define FONT_KEY_LECO_38_BOLD_NUMBERS	"RESOURCE_ID_LECO_38_BOLD_NUMBERS"
+GFont fonts_get_system_font(const char* key);
+
+// Resources, generated from appinfo.json by the SDK
+enum {
+	RESOURCE_ID_ATLAS = 1
+};
+
+// Bitmaps
+typedef struct GBitmap GBitmap;
+GBitmap* gbitmap_create_with_resource(uint32_t resourceId);
+GBitmap* gbitmap_create_as_sub_bitmap(const GBitmap* parent, GRect rect);
+void gbitmap_destroy(GBitmap* bitmap);
+
+// Drawing
+typedef struct GContext GContext;
+void graphics_context_set_fill_color(GContext* context, GColor color);
+void graphics_context_set_text_color(GContext* context, GColor color);
+void graphics_fill_rect(GContext* context, GRect rect, uint16_t radius, GCornerMask corners);
+void graphics_draw_bitmap_in_rect(GContext* context, const GBitmap* bitmap, GRect rect);
+void graphics_draw_text(GContext* context, const char* text, GFont font, GRect box, GTextOverflowMode overflow,
+		GTextAlignment alignment, GTextAttributes* attributes);
+GSize graphics_text_layout_get_content_size(const char* text, GFont font, GRect box, GTextOverflowMode overflow,
+		GTextAlignment alignment);
+
+// Layers and windows
+typedef struct Layer Layer;
+typedef void (*LayerUpdateProc)(Layer* layer, GContext* context);
+Layer* layer_create(GRect frame);
+void layer_destroy(Layer* layer);
+void layer_set_update_proc(Layer* layer, LayerUpdateProc update);
+void layer_mark_dirty(Layer* layer);
+GRect layer_get_frame(const Layer* layer);
+GRect layer_get_bounds(const Layer* layer);
+void layer_add_child(Layer* parent, Layer* child);
+void layer_remove_from_parent(Layer* child);
+void layer_set_hidden(Layer* layer, bool hidden);
+
+typedef struct TextLayer TextLayer;
+TextLayer* text_layer_create(GRect frame);
+void text_layer_destroy(TextLayer* layer);
+Layer* text_layer_get_layer(TextLayer* layer);
+void text_layer_set_text(TextLayer* layer, const char* text);
+void text_layer_set_font(TextLayer* layer, GFont font);
+void text_layer_set_text_alignment(TextLayer* layer, GTextAlignment alignment);
+void text_layer_set_text_color(TextLayer* layer, GColor color);
+void text_layer_set_background_color(TextLayer* layer, GColor color);
+
+typedef struct BitmapLayer BitmapLayer;
+BitmapLayer* bitmap_layer_create(GRect frame);
+void bitmap_layer_destroy(BitmapLayer* layer);
+Layer* bitmap_layer_get_layer(BitmapLayer* layer);
+void bitmap_layer_set_bitmap(BitmapLayer* layer, const GBitmap* bitmap);
+void bitmap_layer_set_alignment(BitmapLayer* layer, GAlign alignment);
+
+typedef struct InverterLayer InverterLayer;
+InverterLayer* inverter_layer_create(GRect frame);
+void inverter_layer_destroy(InverterLayer* layer);
+Layer* inverter_layer_get_layer(InverterLayer* layer);
+
+typedef struct Window Window;
+typedef void (*WindowHandler)(Window* window);
+typedef struct {
+	WindowHandler load;
+	WindowHandler appear;
+	WindowHandler disappear;
+	WindowHandler unload;
+} WindowHandlers;
+Window* window_create(void);
+void window_destroy(Window* window);
+void window_set_window_handlers(Window* window, WindowHandlers handlers);
+Layer* window_get_root_layer(const Window* window);
+void window_stack_push(Window* window, bool animated);
+
+// Timers
+typedef struct AppTimer AppTimer;
+typedef void (*AppTimerCallback)(void* data);
+AppTimer* app_timer_register(uint32_t timeoutMs, AppTimerCallback callback, void* data);
+void app_timer_cancel(AppTimer* timer);
+
+// Services only the app has
+typedef void (*BluetoothConnectionHandler)(bool connected);
+void bluetooth_connection_service_subscribe(BluetoothConnectionHandler handler);
+void bluetooth_connection_service_unsubscribe(void);
+bool bluetooth_connection_service_peek(void);
+void vibes_short_pulse(void);
+void vibes_double_pulse(void);
+
+// Dictionaries, in the SDK's wire format: a count, then key, type, length and value per tuple
+typedef enum {
+	TUPLE_BYTE_ARRAY = 0,
+	TUPLE_CSTRING = 1,
+	TUPLE_UINT = 2,
+	TUPLE_INT = 3
+} TupleType;
+
+typedef struct __attribute__((__packed__)) {
+	uint32_t key;
+	uint8_t type;
+	uint16_t length;
+	union __attribute__((__packed__)) {
+		uint8_t data[0];
+		char cstring[0];
+		uint8_t uint8;
+		uint16_t uint16;
+		uint32_t uint32;
+		int8_t int8;
+		int16_t int16;
+		int32_t int32;
+	} value[];
+} Tuple;
+
+typedef struct __attribute__((__packed__)) {
+	uint8_t count;
+	Tuple head[];
+} Dictionary;
+
+typedef struct {
+	Dictionary* dictionary;
+	const void* end;
+	Tuple* cursor;
+} DictionaryIterator;
+
+typedef struct {
+	TupleType type;
+	uint32_t key;
+	union {
+		struct {
+			const uint8_t* data;
+			uint16_t length;
+		} bytes;
+		struct {
+			const char* data;
+			uint16_t length;
+		} cstring;
+		struct {
+			uint32_t storage;
+			uint16_t width;
+		} integer;
+	};
+} Tuplet;
+#define TupletInteger(_key, _integer)	((const Tuplet) { .type = TUPLE_INT, .key = (_key), .integer = { .storage = (_integer), .width = sizeof(_integer) } })
+
+typedef enum {
+	DICT_OK = 0,
+	DICT_NOT_ENOUGH_STORAGE = 1 << 1,
+	DICT_INVALID_ARGS = 1 << 2
+} DictionaryResult;
+uint32_t dict_calc_buffer_size(uint8_t count, ...);
+uint32_t dict_size(DictionaryIterator* iter);
+Tuple* dict_find(const DictionaryIterator* iter, uint32_t key);
+DictionaryResult dict_write_tuplet(DictionaryIterator* iter, const Tuplet* tuplet);
+DictionaryResult dict_write_uint32(DictionaryIterator* iter, uint32_t key, uint32_t value);
+DictionaryResult dict_write_data(DictionaryIterator* iter, uint32_t key, const uint8_t* data, uint16_t size);
+
+// AppMessage, to the phone
+typedef enum {
+	APP_MSG_OK = 0,
+	APP_MSG_SEND_TIMEOUT = 1 << 1,
+	APP_MSG_SEND_REJECTED = 1 << 2,
+	APP_MSG_NOT_CONNECTED = 1 << 3,
+	APP_MSG_APP_NOT_RUNNING = 1 << 4,
+	APP_MSG_INVALID_ARGS = 1 << 5,
+	APP_MSG_BUSY = 1 << 6,
+	APP_MSG_BUFFER_OVERFLOW = 1 << 7,
+	APP_MSG_OUT_OF_MEMORY = 1 << 10,
+	APP_MSG_CLOSED = 1 << 11
+} AppMessageResult;
+typedef void (*AppMessageInboxReceived)(DictionaryIterator* iterator, void* context);
+typedef void (*AppMessageInboxDropped)(AppMessageResult reason, void* context);
+typedef void (*AppMessageOutboxSent)(DictionaryIterator* iterator, void* context);
+typedef void (*AppMessageOutboxFailed)(DictionaryIterator* iterator, AppMessageResult reason, void* context);
+AppMessageResult app_message_open(uint32_t inboxSize, uint32_t outboxSize);
+uint32_t app_message_outbox_size_maximum(void);
+AppMessageInboxReceived app_message_register_inbox_received(AppMessageInboxReceived callback);
+AppMessageInboxDropped app_message_register_inbox_dropped(AppMessageInboxDropped callback);
+AppMessageOutboxSent app_message_register_outbox_sent(AppMessageOutboxSent callback);
+AppMessageOutboxFailed app_message_register_outbox_failed(AppMessageOutboxFailed callback);
+void app_message_deregister_callbacks(void);
+AppMessageResult app_message_outbox_begin(DictionaryIterator** iterator);
+AppMessageResult app_message_outbox_send(void);
+
+#endif
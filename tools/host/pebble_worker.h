@@ -0,0 +1,137 @@
+#ifndef _PEBBLE_WORKER_H_
+#define _PEBBLE_WORKER_H_
+
+/*
+ * Host stand-in for the SDK's worker header: just the part of the API the worker uses. The services are
+ * implemented in shim.c and driven from host.h, on a simulated clock.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Logging
+enum {
+	APP_LOG_LEVEL_ERROR = 1,
+	APP_LOG_LEVEL_WARNING = 50,
+	APP_LOG_LEVEL_INFO = 100,
+	APP_LOG_LEVEL_DEBUG = 200,
+	APP_LOG_LEVEL_DEBUG_VERBOSE = 255
+};
+void app_log(uint8_t level, const char* file, int line, const char* fmt, ...);
+#define APP_LOG(level, fmt, ...)	app_log((level), __FILE__, __LINE__, (fmt), ##__VA_ARGS__)
+
+// Time: the simulated clock replaces time(), local time follows the TZ environment variable
+time_t hostTime(time_t* t);
+#define time(t)	hostTime(t)
+uint16_t time_ms(time_t* seconds, uint16_t* milliseconds);
+
+typedef enum {
+	SECOND_UNIT = 1 << 0,
+	MINUTE_UNIT = 1 << 1,
+	HOUR_UNIT = 1 << 2,
+	DAY_UNIT = 1 << 3
+} TimeUnits;
+typedef void (*TickHandler)(struct tm* tickTime, TimeUnits unitsChanged);
+void tick_timer_service_subscribe(TimeUnits units, TickHandler handler);
+void tick_timer_service_unsubscribe(void);
+
+// Trigonometry
+#define TRIG_MAX_RATIO	0xffff
+#define TRIG_MAX_ANGLE	0x10000
+int32_t sin_lookup(int32_t angle);
+int32_t cos_lookup(int32_t angle);
+
+// Accelerometer
+typedef struct {
+	int16_t x;
+	int16_t y;
+	int16_t z;
+	bool did_vibrate;
+	uint64_t timestamp;
+} AccelData;
+
+typedef enum {
+	ACCEL_SAMPLING_10HZ = 10,
+	ACCEL_SAMPLING_25HZ = 25,
+	ACCEL_SAMPLING_50HZ = 50,
+	ACCEL_SAMPLING_100HZ = 100
+} AccelSamplingRate;
+
+typedef enum {
+	ACCEL_AXIS_X = 0,
+	ACCEL_AXIS_Y = 1,
+	ACCEL_AXIS_Z = 2
+} AccelAxisType;
+
+typedef void (*AccelDataHandler)(AccelData* data, uint32_t size);
+typedef void (*AccelTapHandler)(AccelAxisType axis, int32_t direction);
+void accel_data_service_subscribe(uint32_t samplesPerUpdate, AccelDataHandler handler);
+void accel_data_service_unsubscribe(void);
+int accel_service_set_sampling_rate(AccelSamplingRate rate);
+int accel_service_set_samples_per_update(uint32_t samplesPerUpdate);
+void accel_tap_service_subscribe(AccelTapHandler handler);
+void accel_tap_service_unsubscribe(void);
+
+// Battery
+typedef struct {
+	uint8_t charge_percent;
+	bool is_charging;
+	bool is_plugged;
+} BatteryChargeState;
+typedef void (*BatteryStateHandler)(BatteryChargeState charge);
+void battery_state_service_subscribe(BatteryStateHandler handler);
+void battery_state_service_unsubscribe(void);
+BatteryChargeState battery_state_service_peek(void);
+
+// Worker <-> app messages
+typedef struct {
+	uint16_t data0;
+	uint16_t data1;
+	uint16_t data2;
+} AppWorkerMessage;
+typedef void (*AppWorkerMessageHandler)(uint16_t type, AppWorkerMessage* data);
+int app_worker_send_message(uint8_t type, AppWorkerMessage* data);
+bool app_worker_message_subscribe(AppWorkerMessageHandler handler);
+bool app_worker_message_unsubscribe(void);
+void worker_event_loop(void);
+
+// Data logging
+typedef struct DataLoggingSession* DataLoggingSessionRef;
+typedef enum {
+	DATA_LOGGING_BYTE_ARRAY = 0,
+	DATA_LOGGING_UINT = 2,
+	DATA_LOGGING_INT = 3
+} DataLoggingItemType;
+typedef enum {
+	DATA_LOGGING_SUCCESS = 0,
+	DATA_LOGGING_BUSY,
+	DATA_LOGGING_FULL,
+	DATA_LOGGING_NOT_FOUND,
+	DATA_LOGGING_CLOSED,
+	DATA_LOGGING_INVALID_PARAMS
+} DataLoggingResult;
+DataLoggingSessionRef data_logging_create(uint32_t tag, DataLoggingItemType itemType, uint16_t itemLength, bool resume);
+DataLoggingResult data_logging_log(DataLoggingSessionRef session, const void* data, uint32_t numItems);
+void data_logging_finish(DataLoggingSessionRef session);
+
+// Persistent storage
+typedef int32_t status_t;
+#define PERSIST_DATA_MAX_LENGTH	256
+bool persist_exists(uint32_t key);
+int32_t persist_read_int(uint32_t key);
+bool persist_read_bool(uint32_t key);
+int persist_read_data(uint32_t key, void* buffer, size_t size);
+status_t persist_write_int(uint32_t key, int32_t value);
+status_t persist_write_bool(uint32_t key, bool value);
+int persist_write_data(uint32_t key, const void* data, size_t size);
+status_t persist_delete(uint32_t key);
+
+// Memory
+size_t heap_bytes_used(void);
+size_t heap_bytes_free(void);
+
+#endif
@@ -0,0 +1,338 @@
+#include <math.h>
+#include <stdarg.h>
+#include "host.h"
+
+static uint64_t mNow = 0;
+static uint8_t mLogLevel = 0;
+
+static AccelDataHandler mAccelHandler = NULL;
+static uint32_t mAccelBatchSize = 0;
+static AccelTapHandler mTapHandler = NULL;
+static TickHandler mTickHandler = NULL;
+static TimeUnits mTickUnits = 0;
+static BatteryStateHandler mBatteryHandler = NULL;
+static BatteryChargeState mBattery = { 100, false, false };
+static AppWorkerMessageHandler mWorkerMessageHandler = NULL;
+static HostMessageHook mMessageHook = NULL;
+static HostDataLogHook mDataLogHook = NULL;
+
+typedef struct {
+	bool exists;
+	uint16_t size;
+	uint8_t data[PERSIST_DATA_MAX_LENGTH];
+} PersistEntry;
+static PersistEntry mPersist[HOST_PERSIST_KEYS];
+static uint32_t mPersistWrites = 0;
+
+struct DataLoggingSession {
+	uint32_t tag;
+	uint16_t itemLength;
+};
+
+
+void app_log(uint8_t level, const char* file, int line, const char* fmt, ...) {
+	if (level > mLogLevel)
+		return;
+	va_list args;
+	va_start(args, fmt);
+	fprintf(stderr, "%s:%d ", file, line);
+	vfprintf(stderr, fmt, args);
+	fputc('\n', stderr);
+	va_end(args);
+}
+
+
+void hostSetLogLevel(uint8_t level) {
+	mLogLevel = level;
+}
+
+
+void hostSetTime(uint64_t milliseconds) {
+	mNow = milliseconds;
+}
+
+
+uint64_t hostNow() {
+	return mNow;
+}
+
+
+time_t hostTime(time_t* t) {
+	time_t seconds = (time_t) (mNow / 1000);
+	if (t != NULL)
+		*t = seconds;
+	return seconds;
+}
+
+
+uint16_t time_ms(time_t* seconds, uint16_t* milliseconds) {
+	uint16_t ms = (uint16_t) (mNow % 1000);
+	if (seconds != NULL)
+		*seconds = (time_t) (mNow / 1000);
+	if (milliseconds != NULL)
+		*milliseconds = ms;
+	return ms;
+}
+
+
+void tick_timer_service_subscribe(TimeUnits units, TickHandler handler) {
+	mTickUnits = units;
+	mTickHandler = handler;
+}
+
+
+void tick_timer_service_unsubscribe(void) {
+	mTickHandler = NULL;
+}
+
+
+TickHandler hostTickHandler() {
+	return mTickHandler;
+}
+
+
+TimeUnits hostTickUnits() {
+	return mTickUnits;
+}
+
+
+// The SDK's tables have the same range, rounding may differ in the last bit
+int32_t sin_lookup(int32_t angle) {
+	return (int32_t) lround(sin(2.0 * M_PI * angle / TRIG_MAX_ANGLE) * TRIG_MAX_RATIO);
+}
+
+
+int32_t cos_lookup(int32_t angle) {
+	return (int32_t) lround(cos(2.0 * M_PI * angle / TRIG_MAX_ANGLE) * TRIG_MAX_RATIO);
+}
+
+
+void accel_data_service_subscribe(uint32_t samplesPerUpdate, AccelDataHandler handler) {
+	mAccelBatchSize = samplesPerUpdate;
+	mAccelHandler = handler;
+}
+
+
+void accel_data_service_unsubscribe(void) {
+	mAccelHandler = NULL;
+}
+
+
+int accel_service_set_sampling_rate(AccelSamplingRate rate) {
+	return 0;
+}
+
+
+int accel_service_set_samples_per_update(uint32_t samplesPerUpdate) {
+	mAccelBatchSize = samplesPerUpdate;
+	return 0;
+}
+
+
+AccelDataHandler hostAccelHandler() {
+	return mAccelHandler;
+}
+
+
+uint32_t hostAccelBatchSize() {
+	return mAccelBatchSize;
+}
+
+
+void accel_tap_service_subscribe(AccelTapHandler handler) {
+	mTapHandler = handler;
+}
+
+
+void accel_tap_service_unsubscribe(void) {
+	mTapHandler = NULL;
+}
+
+
+AccelTapHandler hostTapHandler() {
+	return mTapHandler;
+}
+
+
+void battery_state_service_subscribe(BatteryStateHandler handler) {
+	mBatteryHandler = handler;
+}
+
+
+void battery_state_service_unsubscribe(void) {
+	mBatteryHandler = NULL;
+}
+
+
+BatteryChargeState battery_state_service_peek(void) {
+	return mBattery;
+}
+
+
+BatteryStateHandler hostBatteryHandler() {
+	return mBatteryHandler;
+}
+
+
+void hostSetBattery(BatteryChargeState state) {
+	mBattery = state;
+	if (mBatteryHandler != NULL)
+		mBatteryHandler(state);
+}
+
+
+int app_worker_send_message(uint8_t type, AppWorkerMessage* data) {
+	if (mMessageHook != NULL)
+		mMessageHook(type, data);
+	return 0;
+}
+
+
+bool app_worker_message_subscribe(AppWorkerMessageHandler handler) {
+	mWorkerMessageHandler = handler;
+	return true;
+}
+
+
+bool app_worker_message_unsubscribe(void) {
+	mWorkerMessageHandler = NULL;
+	return true;
+}
+
+
+AppWorkerMessageHandler hostWorkerMessageHandler() {
+	return mWorkerMessageHandler;
+}
+
+
+void hostSetMessageHook(HostMessageHook hook) {
+	mMessageHook = hook;
+}
+
+
+// The host drives the events itself, see host.h
+void worker_event_loop(void) {
+}
+
+
+DataLoggingSessionRef data_logging_create(uint32_t tag, DataLoggingItemType itemType, uint16_t itemLength, bool resume) {
+	DataLoggingSessionRef session = malloc(sizeof(struct DataLoggingSession));
+	session->tag = tag;
+	session->itemLength = itemType == DATA_LOGGING_BYTE_ARRAY ? itemLength : 4;
+	return session;
+}
+
+
+DataLoggingResult data_logging_log(DataLoggingSessionRef session, const void* data, uint32_t numItems) {
+	if (session == NULL)
+		return DATA_LOGGING_INVALID_PARAMS;
+	if (mDataLogHook != NULL)
+		mDataLogHook(session->tag, data, session->itemLength, numItems);
+	return DATA_LOGGING_SUCCESS;
+}
+
+
+void data_logging_finish(DataLoggingSessionRef session) {
+	free(session);
+}
+
+
+void hostSetDataLogHook(HostDataLogHook hook) {
+	mDataLogHook = hook;
+}
+
+
+void hostClearPersist() {
+	memset(mPersist, 0, sizeof(mPersist));
+	mPersistWrites = 0;
+}
+
+
+uint32_t hostPersistWrites() {
+	return mPersistWrites;
+}
+
+
+bool hostSavePersist(const char* path) {
+	FILE* file = fopen(path, "wb");
+	if (file == NULL)
+		return false;
+	bool ok = fwrite(mPersist, sizeof(mPersist), 1, file) == 1;
+	return fclose(file) == 0 && ok;
+}
+
+
+bool hostLoadPersist(const char* path) {
+	FILE* file = fopen(path, "rb");
+	if (file == NULL)
+		return false;
+	bool ok = fread(mPersist, sizeof(mPersist), 1, file) == 1;
+	fclose(file);
+	return ok;
+}
+
+
+bool persist_exists(uint32_t key) {
+	return key < HOST_PERSIST_KEYS && mPersist[key].exists;
+}
+
+
+int persist_read_data(uint32_t key, void* buffer, size_t size) {
+	if (!persist_exists(key))
+		return -1;
+	size_t length = size < mPersist[key].size ? size : mPersist[key].size;
+	memcpy(buffer, mPersist[key].data, length);
+	return (int) length;
+}
+
+
+int persist_write_data(uint32_t key, const void* data, size_t size) {
+	if (key >= HOST_PERSIST_KEYS || size > PERSIST_DATA_MAX_LENGTH) {
+		fprintf(stderr, "persist_write_data: key %u, %zu bytes is out of range\n", key, size);
+		abort();
+	}
+	mPersist[key].exists = true;
+	mPersist[key].size = (uint16_t) size;
+	memcpy(mPersist[key].data, data, size);
+	mPersistWrites++;
+	return (int) size;
+}
+
+
+int32_t persist_read_int(uint32_t key) {
+	int32_t value = 0;
+	persist_read_data(key, &value, sizeof(value));
+	return value;
+}
+
+
+bool persist_read_bool(uint32_t key) {
+	return persist_read_int(key) != 0;
+}
+
+
+status_t persist_write_int(uint32_t key, int32_t value) {
+	return persist_write_data(key, &value, sizeof(value));
+}
+
+
+status_t persist_write_bool(uint32_t key, bool value) {
+	return persist_write_int(key, value);
+}
+
+
+status_t persist_delete(uint32_t key) {
+	if (key < HOST_PERSIST_KEYS)
+		mPersist[key].exists = false;
+	return 0;
+}
+
+
+size_t heap_bytes_used(void) {
+	return 0;
+}
+
+
+size_t heap_bytes_free(void) {
+	return 0;
+}
@@ -0,0 +1,307 @@
+// Run the worker and the watchface side by side and measure what goes between them, to the phone and to the screen.
+// Usage: ipc [-H hours] [-s seed] [-z TZ] [-t start_s] [-e export_hours] [-b battery] [-v]
+// The wearer comes from generator.h and the worker sees it at full rate. Worker messages, the app's replies
+// and AppMessage with the phone are queued like events on the watch and delivered after each second of
+// samples; the window is then rendered once if anything was marked dirty. The phone acks every message and,
+// every -e hours, asks for a week of history the way the companion app does.
+// Prints one CSV line per simulated hour: messages and bytes each way, dirty marks, frames, layers drawn and
+// draw calls. -v passes the app's and the worker's own logs through to stderr.
+#include <time.h>
+#include <unistd.h>
+#include "host.h"
+#include "generator.h"
+
+#define main workerMain
+#include "worker.c"
+#undef main
+
+#define MAX_HOURS	(24 * 60)
+#define HOUR_MS	3600000ULL
+#define QUEUE_SIZE	64	// Events the app and the worker may have waiting
+#define MESSAGE_BYTES	(sizeof(uint16_t) + sizeof(AppWorkerMessage))	// Type and payload, as the watchface counts them
+#define DICT_INT_BYTES	11	// Tuple header and an int32
+
+// AppMessage keys of the history export, as in export.h
+#define EXPORT_FROM_KEY	20
+#define EXPORT_SEQ_KEY	22
+#define EXPORT_ACK_KEY	24
+#define EXPORT_DONE_KEY	25
+
+// The watchface, in ipc_app.c
+void appInit();
+void appDeinit();
+
+typedef struct {
+	uint32_t workerMessages;	// Worker to app
+	uint32_t workerBytes;
+	uint32_t appMessages;	// App to worker
+	uint32_t appBytes;
+	uint32_t phoneMessages;	// AppMessage, either way
+	uint32_t phoneBytes;
+	uint32_t dropped;	// Worker messages with no room in the queue or no app to take them
+	HostUiCounters ui;	// Over the hour
+} Hour;
+
+typedef struct {
+	bool toApp;
+	uint8_t type;
+	AppWorkerMessage data;
+} Event;
+
+static Generator mGenerator;
+static uint64_t mStart;
+static uint64_t mNow;
+static Hour mHours[MAX_HOURS];
+static Event mQueue[QUEUE_SIZE];
+static uint32_t mQueueHead = 0;
+static uint32_t mQueueCount = 0;
+
+// Phone side
+static uint8_t mPhoneInbox[PERSIST_DATA_MAX_LENGTH * 4];
+static uint32_t mPhoneInboxSize = 0;
+static bool mPhoneReceived = false;
+static uint32_t mExports = 0;
+static uint32_t mExportChunks = 0;
+
+
+static Hour* thisHour() {
+	return &mHours[(mNow - mStart) / HOUR_MS];
+}
+
+
+static void enqueue(bool toApp, uint8_t type, AppWorkerMessage* data) {
+	if (mQueueCount == QUEUE_SIZE) {
+		thisHour()->dropped++;
+		return;
+	}
+	mQueue[(mQueueHead + mQueueCount++) % QUEUE_SIZE] = (Event) { toApp, type, *data };
+}
+
+
+static void workerSent(uint8_t type, AppWorkerMessage* data) {
+	enqueue(true, type, data);
+}
+
+
+static void appSent(uint8_t type, AppWorkerMessage* data) {
+	enqueue(false, type, data);
+}
+
+
+static void outboxSent(const uint8_t* data, uint32_t size) {
+	memcpy(mPhoneInbox, data, size);
+	mPhoneInboxSize = size;
+	mPhoneReceived = true;
+	thisHour()->phoneMessages++;
+	thisHour()->phoneBytes += size;
+}
+
+
+static void phoneSend(uint32_t key, int32_t value) {
+	if (hostPhoneSend(&key, &value, 1)) {
+		thisHour()->phoneMessages++;
+		thisHour()->phoneBytes += 1 + DICT_INT_BYTES;
+	}
+}
+
+
+// Hand over everything waiting, until neither side has anything more to say
+static void settle() {
+	bool busy = true;
+	while (busy) {
+		busy = false;
+		while (mQueueCount > 0) {
+			Event event = mQueue[mQueueHead];
+			mQueueHead = (mQueueHead + 1) % QUEUE_SIZE;
+			mQueueCount--;
+			Hour* hour = thisHour();
+			if (event.toApp) {
+				if (hostAppWorkerMessageHandler() == NULL) {
+					hour->dropped++;
+					continue;
+				}
+				hour->workerMessages++;
+				hour->workerBytes += MESSAGE_BYTES;
+				hostAppWorkerMessageHandler()(event.type, &event.data);
+			} else if (hostWorkerMessageHandler() != NULL) {
+				hour->appMessages++;
+				hour->appBytes += MESSAGE_BYTES;
+				hostWorkerMessageHandler()(event.type, &event.data);
+			}
+			busy = true;
+		}
+
+		// The phone takes every message and acks each export chunk
+		if (mPhoneReceived) {
+			mPhoneReceived = false;
+			int32_t seq;
+			int32_t done;
+			bool chunk = hostDictInt(mPhoneInbox, mPhoneInboxSize, EXPORT_SEQ_KEY, &seq);
+			bool last = hostDictInt(mPhoneInbox, mPhoneInboxSize, EXPORT_DONE_KEY, &done);
+			hostOutboxDone(true);
+			if (chunk) {
+				mExportChunks++;
+				phoneSend(EXPORT_ACK_KEY, seq + 1);
+			}
+			if (last)
+				mExports++;
+			busy = true;
+		}
+		if (hostFireTimers() > 0)
+			busy = true;
+	}
+	hostRender();
+}
+
+
+static void addUi(HostUiCounters* sum, const HostUiCounters* to, const HostUiCounters* from) {
+	sum->dirtyMarks += to->dirtyMarks - from->dirtyMarks;
+	sum->redraws += to->redraws - from->redraws;
+	sum->layersDrawn += to->layersDrawn - from->layersDrawn;
+	sum->drawCalls += to->drawCalls - from->drawCalls;
+}
+
+
+int main(int argc, char** argv) {
+	double hours = 24;
+	uint32_t seed = 1;
+	const char* zone = "UTC";
+	uint64_t start = 1457049600;	// 2016-03-04 00:00 UTC
+	double exportHours = 6;
+	int32_t battery = 100;
+	bool verbose = false;
+	int option;
+	while ((option = getopt(argc, argv, "H:s:z:t:e:b:v")) != -1) {
+		switch (option) {
+			case 'H':
+				hours = atof(optarg);
+				break;
+			case 's':
+				seed = (uint32_t) strtoul(optarg, NULL, 10);
+				break;
+			case 'z':
+				zone = optarg;
+				break;
+			case 't':
+				start = strtoull(optarg, NULL, 10);
+				break;
+			case 'e':
+				exportHours = atof(optarg);
+				break;
+			case 'b':
+				battery = atoi(optarg);
+				break;
+			case 'v':
+				verbose = true;
+				break;
+			default:
+				fprintf(stderr, "usage: ipc [-H hours] [-s seed] [-z TZ] [-t start_s] [-e export_hours] [-b battery] [-v]\n");
+				return 1;
+		}
+	}
+	if (hours <= 0 || hours > MAX_HOURS) {
+		fprintf(stderr, "up to %u hours\n", MAX_HOURS);
+		return 1;
+	}
+	setenv("TZ", zone, 1);
+	tzset();
+	hostSetLogLevel(verbose ? APP_LOG_LEVEL_INFO : 0);
+
+	GeneratorConfig config;
+	defaultGeneratorConfig(&config);
+	config.nights = true;
+	initGenerator(&mGenerator, &config, seed, start * 1000);
+	mStart = mNow = start * 1000;
+	uint64_t end = mStart + (uint64_t) (hours * HOUR_MS);
+	uint64_t exportInterval = (uint64_t) (exportHours * HOUR_MS);
+	uint64_t nextExport = exportInterval > 0 ? mStart + exportInterval : UINT64_MAX;
+
+	hostClearPersist();
+	hostSetBattery((BatteryChargeState) { (uint8_t) battery, false, false });
+	hostSetMessageHook(&workerSent);
+	hostSetAppMessageHook(&appSent);
+	hostSetOutboxHook(&outboxSent);
+	hostSetTime(mNow);
+
+	// The worker is already running when the watchface comes up
+	init();
+	appInit();
+	settle();
+	HostUiCounters ui = *hostUiCounters();
+	uint32_t hourIndex = 0;
+
+	struct timespec began, ended;
+	clock_gettime(CLOCK_MONOTONIC, &began);
+	while (mNow < end) {
+		AccelData samples[SAMPLE_RATE_HZ];
+		for (uint32_t filled = 0; filled < SAMPLE_RATE_HZ; ) {
+			filled += generate(&mGenerator, samples + filled, NULL, SAMPLE_RATE_HZ - filled);
+		}
+		uint64_t previous = mNow;
+		mNow += 1000;
+		hostSetTime(mNow);
+		for (uint32_t i = 0; i < SAMPLE_RATE_HZ; i++) {
+			samples[i].timestamp = mNow - 1000 + i * (1000 / SAMPLE_RATE_HZ);
+		}
+		if (mNow >= end)
+			break;
+		// Close the hour on the UI counters
+		if ((mNow - mStart) / HOUR_MS != hourIndex) {
+			addUi(&mHours[hourIndex].ui, hostUiCounters(), &ui);
+			ui = *hostUiCounters();
+			hourIndex = (uint32_t) ((mNow - mStart) / HOUR_MS);
+		}
+
+		// The last second's samples, then the minute tick, to both of them
+		for (uint32_t i = 0; i + BATCH_SIZE <= SAMPLE_RATE_HZ && hostAccelHandler() != NULL; i += BATCH_SIZE) {
+			hostAccelHandler()(samples + i, BATCH_SIZE);
+		}
+		if (mNow / 60000 != previous / 60000) {
+			time_t seconds = (time_t) (mNow / 1000);
+			if (hostTickHandler() != NULL)
+				hostTickHandler()(localtime(&seconds), MINUTE_UNIT);
+			if (hostAppTickHandler() != NULL)
+				hostAppTickHandler()(localtime(&seconds), MINUTE_UNIT);
+		}
+		if (mNow >= nextExport) {
+			phoneSend(EXPORT_FROM_KEY, (int32_t) (mNow / 1000 - 7 * DAY_S));
+			nextExport += exportInterval;
+		}
+		settle();
+	}
+	addUi(&mHours[hourIndex].ui, hostUiCounters(), &ui);
+	clock_gettime(CLOCK_MONOTONIC, &ended);
+
+	appDeinit();
+	deinit();
+
+	Hour total;
+	memset(&total, 0, sizeof(Hour));
+	uint32_t hourCount = (uint32_t) ((end - mStart + HOUR_MS - 1) / HOUR_MS);
+	printf("hour,worker_messages,worker_bytes,app_messages,app_bytes,phone_messages,phone_bytes,dropped,dirty_marks,redraws,layers_drawn,draw_calls\n");
+	for (uint32_t i = 0; i < hourCount; i++) {
+		Hour* hour = &mHours[i];
+		printf("%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n", i, hour->workerMessages, hour->workerBytes, hour->appMessages,
+				hour->appBytes, hour->phoneMessages, hour->phoneBytes, hour->dropped, hour->ui.dirtyMarks, hour->ui.redraws,
+				hour->ui.layersDrawn, hour->ui.drawCalls);
+		total.workerMessages += hour->workerMessages;
+		total.workerBytes += hour->workerBytes;
+		total.appMessages += hour->appMessages;
+		total.appBytes += hour->appBytes;
+		total.phoneMessages += hour->phoneMessages;
+		total.phoneBytes += hour->phoneBytes;
+		total.dropped += hour->dropped;
+		total.ui.dirtyMarks += hour->ui.dirtyMarks;
+		total.ui.redraws += hour->ui.redraws;
+		total.ui.drawCalls += hour->ui.drawCalls;
+	}
+
+	double seconds = (ended.tv_sec - began.tv_sec) + (ended.tv_nsec - began.tv_nsec) / 1e9;
+	fprintf(stderr, "%.1f hours in %.1f s, %u exports (%u chunks)\n", hours, seconds, mExports, mExportChunks);
+	fprintf(stderr, "per hour: %.0f worker messages (%.0f bytes), %.0f app messages (%.0f bytes), %.0f phone messages (%.0f bytes), %.0f dropped\n",
+			total.workerMessages / hours, total.workerBytes / hours, total.appMessages / hours, total.appBytes / hours,
+			total.phoneMessages / hours, total.phoneBytes / hours, total.dropped / hours);
+	fprintf(stderr, "per hour: %.0f dirty marks, %.0f redraws, %.0f draw calls\n", total.ui.dirtyMarks / hours,
+			total.ui.redraws / hours, total.ui.drawCalls / hours);
+	return 0;
+}
@@ -0,0 +1,16 @@
+// The watchface for ipc.c, main renamed. It has its own init, deinit and statics, so it gets a unit of its own.
+#include <pebble.h>
+
+#define main appMain
+#include "main.c"
+#undef main
+
+
+void appInit() {
+	init();
+}
+
+
+void appDeinit() {
+	deinit();
+}
@@ -0,0 +1,151 @@
+// Host harness for the companion JS location policy: mocked Pebble, navigator.geolocation, timers and clock.
+// Usage: node tools/js/location-test.js [path/to/pebble-js-app.js]
+var fs = require("fs");
+var path = require("path");
+var vm = require("vm");
+var assert = require("assert");
+
+var SCRIPT = process.argv[2] || path.join(__dirname, "..", "..", "Aplite", "src", "js", "pebble-js-app.js");
+var MINUTE = 60000;
+
+// One sandbox per scenario, so module state (ring, backoff) starts clean
+function load(route) {
+	var world = {
+		now: Date.UTC(2016, 0, 1, 8, 0, 0),
+		handlers: {},
+		sent: [],
+		requests: []	// Every getCurrentPosition call with its options
+	};
+
+	// Position at the current time; route(t) gives { lat, lon, accuracy, speed }
+	function fix() {
+		var at = route(world.now);
+		return {
+			timestamp: world.now,
+			coords: { latitude: at.lat, longitude: at.lon, accuracy: at.accuracy, speed: at.speed === undefined ? null : at.speed }
+		};
+	}
+
+	// Date.now() is the simulated clock, new Date(t) still works for the log lines
+	var FakeDate = function(t) { return new Date(t === undefined ? world.now : t); };
+	FakeDate.now = function() { return world.now; };
+
+	var sandbox = {
+		console: { log: function() {} },
+		Math: Math,
+		JSON: JSON,
+		Date: FakeDate,
+		setTimeout: function() { return 0; },
+		clearTimeout: function() {},
+		localStorage: { setItem: function() {}, getItem: function() { return null; } },
+		decodeURIComponent: decodeURIComponent,
+		Pebble: {
+			addEventListener: function(name, handler) { world.handlers[name] = handler; },
+			sendAppMessage: function(message) { world.sent.push(message); },
+			openURL: function() {}
+		},
+		navigator: {
+			geolocation: {
+				getCurrentPosition: function(success, failure, options) {
+					world.requests.push(options);
+					// Cached fixes younger than maximumAge come back without using the receiver
+					success(fix());
+				}
+			}
+		}
+	};
+	vm.runInNewContext(fs.readFileSync(SCRIPT, "utf8"), sandbox, { filename: SCRIPT });
+
+	// The watch asks for the speed, with its current activity type; returns the speed sent back in m/s
+	world.poll = function(activityType) {
+		world.sent = [];
+		world.handlers.appmessage({ payload: { requestSpeed: activityType } });
+		var replies = world.sent.filter(function(message) { return message.speed !== undefined; });
+		assert.strictEqual(replies.length, 1, "one speed reply per request");
+		return replies[0].speed / 100;
+	};
+	world.advance = function(ms) { world.now += ms; };
+	return world;
+}
+
+// Straight line east along the equator at the given speed, after the given start time
+function drive(start, speed, accuracy) {
+	return function(t) {
+		var meters = t > start ? (t - start) / 1000 * speed : 0;
+		return { lat: 0, lon: meters / 111195, accuracy: accuracy };
+	};
+}
+
+var scenarios = {
+	"coarse fix first, high accuracy only when it is poor": function() {
+		var good = load(drive(Infinity, 0, 30));
+		good.poll(2);
+		assert.strictEqual(good.requests.length, 1);
+		assert.strictEqual(good.requests[0].enableHighAccuracy, false);
+		assert.ok(good.requests[0].maximumAge > 0, "recent fixes are reused");
+
+		var poor = load(drive(Infinity, 0, 800));
+		poor.poll(2);
+		assert.strictEqual(poor.requests.length, 2);
+		assert.strictEqual(poor.requests[1].enableHighAccuracy, true);
+	},
+
+	"backs off while sitting still": function() {
+		var world = load(drive(Infinity, 0, 30));
+		for (var i = 0; i < 24; i++) {	// Two hours of polls every 5 minutes
+			world.poll(1);
+			world.advance(5 * MINUTE);
+		}
+		assert.ok(world.requests.length <= 8, "fixes while resting: " + world.requests.length);
+	},
+
+	"speed comes from the ring, not the last fix alone": function() {
+		var world = load(drive(0, 12, 30));
+		world.poll(2);
+		world.advance(5 * MINUTE);
+		var speed = world.poll(2);
+		assert.ok(Math.abs(speed - 12) < 0.5, "speed " + speed);
+	},
+
+	"driving after a long rest is seen within one poll of the backoff ending": function() {
+		var start = Date.UTC(2016, 0, 1, 10, 0, 0);	// Two hours of sitting, then driving at 15 m/s
+		var world = load(drive(start, 15, 30));
+		var seenAt = null;
+		for (var i = 0; i < 48 && seenAt == null; i++) {
+			var speed = world.poll(1);	// The watch still reports sitting while in the car
+			if (world.now > start && speed >= 5) {
+				seenAt = world.now;
+			}
+			world.advance(5 * MINUTE);
+		}
+		assert.ok(seenAt != null, "never saw the drive");
+		// Worst case: the longest backoff (40 minutes) plus the one poll that gets the second fix
+		var delay = (seenAt - start) / MINUTE;
+		assert.ok(delay <= 45, "seen after " + delay + " minutes");
+	},
+
+	"old fixes do not dilute the estimate": function() {
+		var start = Date.UTC(2016, 0, 1, 9, 0, 0);
+		var world = load(drive(start, 15, 30));
+		world.poll(2);	// 08:00, parked
+		world.advance(55 * MINUTE);
+		world.poll(2);	// 08:55, still parked
+		world.advance(10 * MINUTE);
+		world.poll(2);	// 09:05, driving for 5 minutes
+		world.advance(5 * MINUTE);
+		var speed = world.poll(2);	// 09:10
+		assert.ok(Math.abs(speed - 15) < 0.5, "speed " + speed);
+	}
+};
+
+var failed = 0;
+Object.keys(scenarios).forEach(function(name) {
+	try {
+		scenarios[name]();
+		console.log("ok    " + name);
+	} catch (e) {
+		failed++;
+		console.log("FAIL  " + name + ": " + e.message);
+	}
+});
+process.exit(failed > 0 ? 1 : 0);
@@ -0,0 +1,31 @@
+#ifndef _LOADFILE_H_
+#define _LOADFILE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+// Whole file, or stdin for NULL, into a malloc'ed buffer. NULL on error, with the reason on stderr.
+static inline uint8_t* loadFile(const char* path, size_t* size) {
+	FILE* file = path != NULL ? fopen(path, "rb") : stdin;
+	if (file == NULL) {
+		perror(path);
+		return NULL;
+	}
+	size_t capacity = 1 << 16;
+	uint8_t* bytes = malloc(capacity);
+	*size = 0;
+	size_t got;
+	while ((got = fread(bytes + *size, 1, capacity - *size, file)) > 0) {
+		*size += got;
+		if (*size == capacity) {
+			capacity *= 2;
+			bytes = realloc(bytes, capacity);
+		}
+	}
+	if (file != stdin)
+		fclose(file);
+	return bytes;
+}
+
+#endif
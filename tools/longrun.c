@@ -0,0 +1,334 @@
+// Run the real worker (init, callbacks, deinit) for weeks of simulated time and check its accounting.
+// Usage: longrun [-d days] [-s seed] [-z TZ] [-t start_s] [-k hours] [-j jumps_per_day] [-b battery] [-r reset_minutes]
+// The wearer comes from generator.h. Every lifetime of the worker runs in its own process, so a kill loses
+// exactly what it loses on the watch: everything but the persisted keys. Kills come on average every -k hours;
+// half of them skip deinit and the rest are clean restarts. The watch clock jumps by up to 15 minutes -j times
+// a day. -z takes any TZ value, the default one has a DST change in the second week.
+// Prints one CSV line per simulated day: how long the worker ran against what it logged to the phone, steps
+// against the truth, persist writes, messages, CPU time and the worker's own profiler counters: samples,
+// windows, gated batches and suspended minutes.
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "host.h"
+#include "generator.h"
+
+#define main workerMain
+#include "worker.c"
+#undef main
+
+#define MAX_DAYS	400
+#define DAY_MS		(DAY_S * 1000ULL)
+#define MAX_JUMP_S	900
+#define MAX_DOWNTIME_S	600
+
+typedef struct {
+	uint64_t uptime;	// Seconds the worker ran
+	uint64_t credited;	// Seconds of activity in its data logs
+	uint64_t steps;	// In its data logs
+	uint64_t truthSteps;
+	uint32_t dataLogs;
+	uint32_t persistWrites;
+	uint32_t messages;
+	uint32_t kills;
+	uint32_t restarts;
+	int32_t jumped;	// Net clock jumps, s
+	int32_t utcOffset;	// At the start of the day, s
+	double cpu;	// Worker CPU time, s
+	uint32_t profiled[PROFILER_COUNTERS];	// What the worker's profiler counted during the day
+} Day;
+
+// Shared with each worker process, which carries the simulation on for its lifetime
+typedef struct {
+	Generator generator;
+	uint64_t start;	// True time, ms
+	uint64_t end;
+	uint64_t now;
+	int64_t offset;	// Watch clock minus true time, ms
+	uint32_t random;
+	double killOdds;	// Per simulated second
+	double jumpOdds;
+	Day days[MAX_DAYS];
+} Simulation;
+
+static Simulation* mSim;
+static const char* mPersistPath;
+
+
+static uint32_t nextRandom() {
+	mSim->random ^= mSim->random << 13;
+	mSim->random ^= mSim->random >> 17;
+	mSim->random ^= mSim->random << 5;
+	return mSim->random;
+}
+
+
+static double uniform() {
+	return (nextRandom() % 1000000) / 1000000.0;
+}
+
+
+static Day* today() {
+	return &mSim->days[(mSim->now - mSim->start) / DAY_MS];
+}
+
+
+// Adds what the profiler counted since the last call; counted holds the counters as they were then
+static void countProfiler(uint32_t* counted) {
+	Day* day = today();
+	for (uint32_t i = 0; i < PROFILER_COUNTERS; i++) {
+		day->profiled[i] += mProfiler.counters[i] - counted[i];
+		counted[i] = mProfiler.counters[i];
+	}
+}
+
+
+static double cpuSeconds() {
+	struct timespec now;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+// One second of the wearer, with or without a worker to see it
+static void generateSecond(AccelData* samples) {
+	for (uint32_t filled = 0; filled < SAMPLE_RATE_HZ; ) {
+		uint64_t steps = mSim->generator.steps;
+		uint32_t count = generate(&mSim->generator, samples + filled, NULL, SAMPLE_RATE_HZ - filled);
+		today()->truthSteps += mSim->generator.steps - steps;
+		filled += count;
+	}
+	mSim->now += 1000;
+}
+
+
+static void dataLogged(uint32_t tag, const uint8_t* data, uint32_t itemLength, uint32_t numItems) {
+	if (tag != 0)
+		return;
+	for (uint32_t i = 0; i < numItems; i++) {
+		uint32_t record[6];
+		memcpy(record, data + i * itemLength, sizeof(record));
+		Day* day = today();
+		day->credited += (uint64_t) record[0] + record[1] + record[2] + record[3];
+		day->steps += record[4];
+		day->dataLogs++;
+	}
+}
+
+
+static void messageSent(uint8_t type, AppWorkerMessage* data) {
+	today()->messages++;
+}
+
+
+// A worker process: init, a second of samples at a time until the next kill, deinit unless it is killed
+static void live() {
+	hostSetDataLogHook(&dataLogged);
+	hostSetMessageHook(&messageSent);
+	hostSetTime(mSim->now + mSim->offset);
+
+	double cpu = cpuSeconds();
+	uint32_t writes = hostPersistWrites();
+	init();
+	today()->cpu += cpuSeconds() - cpu;
+	today()->persistWrites += hostPersistWrites() - writes;
+	writes = hostPersistWrites();
+	uint32_t counted[PROFILER_COUNTERS];
+	memcpy(counted, mProfiler.counters, sizeof(counted));
+
+	bool killed = false;
+	while (mSim->now < mSim->end) {
+		AccelData samples[SAMPLE_RATE_HZ];
+		generateSecond(samples);
+		Day* day = today();
+		day->uptime++;
+
+		if (uniform() < mSim->jumpOdds) {
+			int32_t jump = (int32_t) (nextRandom() % (2 * MAX_JUMP_S + 1)) - MAX_JUMP_S;
+			mSim->offset += jump * 1000LL;
+			day->jumped += jump;
+		}
+		uint64_t clock = mSim->now + mSim->offset;
+		uint64_t previous = hostNow();
+		hostSetTime(clock);
+
+		cpu = cpuSeconds();
+		for (uint32_t i = 0; i < SAMPLE_RATE_HZ; i++) {
+			samples[i].timestamp = clock - 1000 + i * (1000 / SAMPLE_RATE_HZ);
+		}
+		// The service delivers whole batches; the worker may unsubscribe in between
+		for (uint32_t i = 0; i + BATCH_SIZE <= SAMPLE_RATE_HZ && hostAccelHandler() != NULL; i += BATCH_SIZE) {
+			hostAccelHandler()(samples + i, BATCH_SIZE);
+		}
+		if (hostTickHandler() != NULL && clock / 60000 != previous / 60000) {
+			time_t seconds = (time_t) (clock / 1000);
+			hostTickHandler()(localtime(&seconds), MINUTE_UNIT);
+		}
+		day->cpu += cpuSeconds() - cpu;
+		day->persistWrites += hostPersistWrites() - writes;
+		writes = hostPersistWrites();
+		countProfiler(counted);
+
+		if (uniform() < mSim->killOdds) {
+			killed = nextRandom() % 2 == 0;
+			break;
+		}
+	}
+
+	if (killed) {
+		today()->kills++;
+	} else {
+		cpu = cpuSeconds();
+		deinit();
+		today()->cpu += cpuSeconds() - cpu;
+		today()->restarts++;
+	}
+	today()->persistWrites += hostPersistWrites() - writes;
+	hostSavePersist(mPersistPath);
+	_exit(0);
+}
+
+
+int main(int argc, char** argv) {
+	double days = 30;
+	uint32_t seed = 1;
+	const char* zone = "EST5EDT,M3.2.0,M11.1.0";
+	uint64_t start = 1457049600;	// 2016-03-04 00:00 UTC, DST starts on the 13th
+	double lifetime = 36;
+	double jumps = 1;
+	int32_t battery = 100;
+	int32_t resetTime = -1;
+	int option;
+	while ((option = getopt(argc, argv, "d:s:z:t:k:j:b:r:")) != -1) {
+		switch (option) {
+			case 'd':
+				days = atof(optarg);
+				break;
+			case 's':
+				seed = (uint32_t) strtoul(optarg, NULL, 10);
+				break;
+			case 'z':
+				zone = optarg;
+				break;
+			case 't':
+				start = strtoull(optarg, NULL, 10);
+				break;
+			case 'k':
+				lifetime = atof(optarg);
+				break;
+			case 'j':
+				jumps = atof(optarg);
+				break;
+			case 'b':
+				battery = atoi(optarg);
+				break;
+			case 'r':
+				resetTime = atoi(optarg);
+				break;
+			default:
+				fprintf(stderr, "usage: longrun [-d days] [-s seed] [-z TZ] [-t start_s] [-k hours] [-j jumps_per_day] [-b battery] [-r reset_minutes]\n");
+				return 1;
+		}
+	}
+	if (days <= 0 || days > MAX_DAYS) {
+		fprintf(stderr, "1 to %u days\n", MAX_DAYS);
+		return 1;
+	}
+	setenv("TZ", zone, 1);
+	tzset();
+
+	mSim = mmap(NULL, sizeof(Simulation), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	GeneratorConfig config;
+	defaultGeneratorConfig(&config);
+	config.nights = true;
+	initGenerator(&mSim->generator, &config, seed, start * 1000);
+	mSim->start = mSim->now = start * 1000;
+	mSim->end = mSim->start + (uint64_t) (days * DAY_MS);
+	mSim->random = seed * 2654435761u + 1;
+	mSim->killOdds = lifetime > 0 ? 1 / (lifetime * 3600) : 0;
+	mSim->jumpOdds = jumps / DAY_S;
+
+	char path[] = "/tmp/longrun-XXXXXX";
+	int file = mkstemp(path);
+	close(file);
+	mPersistPath = path;
+	hostClearPersist();
+	if (resetTime >= 0)
+		persist_write_int(7, resetTime);
+	hostSetBattery((BatteryChargeState) { (uint8_t) battery, false, false });
+	hostSavePersist(mPersistPath);
+
+	struct timespec began, ended;
+	clock_gettime(CLOCK_MONOTONIC, &began);
+	uint32_t lifetimes = 0;
+	while (mSim->now < mSim->end) {
+		hostLoadPersist(mPersistPath);
+		fflush(stdout);
+		fflush(stderr);
+		pid_t child = fork();
+		if (child == 0)
+			live();
+		int status;
+		waitpid(child, &status, 0);
+		if (! WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			fprintf(stderr, "worker died at %llu\n", (unsigned long long) mSim->now / 1000);
+			unlink(path);
+			return 1;
+		}
+		lifetimes++;
+
+		// Down for a while before the worker is launched again
+		uint32_t downtime = nextRandom() % (MAX_DOWNTIME_S + 1);
+		for (uint32_t i = 0; i < downtime && mSim->now < mSim->end; i++) {
+			AccelData samples[SAMPLE_RATE_HZ];
+			generateSecond(samples);
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ended);
+	unlink(path);
+
+	Day total;
+	memset(&total, 0, sizeof(Day));
+	uint32_t dayCount = (uint32_t) ((mSim->end - mSim->start + DAY_MS - 1) / DAY_MS);
+	printf("day,utc_offset,uptime_s,logged_s,drift_s,jumped_s,steps,truth_steps,step_error,data_logs,persist_writes,messages,kills,restarts,cpu_ms,samples,windows,gated_batches,suspended_min\n");
+	for (uint32_t i = 0; i < dayCount; i++) {
+		Day* day = &mSim->days[i];
+		time_t dayStart = (time_t) (mSim->start / 1000 + i * DAY_S);
+		day->utcOffset = (int32_t) localtime(&dayStart)->tm_gmtoff;
+		printf("%u,%d,%llu,%llu,%lld,%d,%llu,%llu,%.3f,%u,%u,%u,%u,%u,%.1f,%u,%u,%u,%u\n", i, day->utcOffset,
+				(unsigned long long) day->uptime, (unsigned long long) day->credited, (long long) day->credited - (long long) day->uptime,
+				day->jumped, (unsigned long long) day->steps, (unsigned long long) day->truthSteps,
+				day->truthSteps > 0 ? ((double) day->steps - day->truthSteps) / day->truthSteps : 0,
+				day->dataLogs, day->persistWrites, day->messages, day->kills, day->restarts, day->cpu * 1000,
+				day->profiled[PROFILER_SAMPLES], day->profiled[PROFILER_WINDOWS], day->profiled[PROFILER_GATED_BATCHES],
+				day->profiled[PROFILER_SUSPENDED_MINUTES]);
+		total.uptime += day->uptime;
+		total.credited += day->credited;
+		total.steps += day->steps;
+		total.truthSteps += day->truthSteps;
+		total.persistWrites += day->persistWrites;
+		total.messages += day->messages;
+		total.kills += day->kills;
+		total.restarts += day->restarts;
+		total.jumped += day->jumped;
+		total.cpu += day->cpu;
+		for (uint32_t j = 0; j < PROFILER_COUNTERS; j++) {
+			total.profiled[j] += day->profiled[j];
+		}
+	}
+
+	double seconds = (ended.tv_sec - began.tv_sec) + (ended.tv_nsec - began.tv_nsec) / 1e9;
+	fprintf(stderr, "%.1f days in %.1f s, %u lifetimes (%u kills, %u restarts)\n", days, seconds, lifetimes, total.kills, total.restarts);
+	fprintf(stderr, "ran %llu s, logged %llu s (drift %+lld s, clock jumps %+d s), steps %llu against %llu (%+.1f%%)\n",
+			(unsigned long long) total.uptime, (unsigned long long) total.credited, (long long) total.credited - (long long) total.uptime,
+			total.jumped, (unsigned long long) total.steps, (unsigned long long) total.truthSteps,
+			total.truthSteps > 0 ? 100.0 * ((double) total.steps - total.truthSteps) / total.truthSteps : 0);
+	fprintf(stderr, "per day: %.0f persist writes, %.0f messages, %.1f ms worker CPU\n", total.persistWrites / days,
+			total.messages / days, total.cpu * 1000 / days);
+	fprintf(stderr, "per hour: %.0f samples, %.0f windows, %.0f gated batches, %.1f suspended minutes\n",
+			total.profiled[PROFILER_SAMPLES] / (days * 24), total.profiled[PROFILER_WINDOWS] / (days * 24),
+			total.profiled[PROFILER_GATED_BATCHES] / (days * 24), total.profiled[PROFILER_SUSPENDED_MINUTES] / (days * 24));
+	munmap(mSim, sizeof(Simulation));
+	return 0;
+}
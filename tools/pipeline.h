@@ -0,0 +1,20 @@
+#ifndef _PIPELINE_H_
+#define _PIPELINE_H_
+
+#include "recognizer.h"
+#include "tracefile.h"
+
+// Only Aplite's recognizer takes the phone's driving hint, never set on replay
+#ifdef TREE_Aplite
+#define NOT_DRIVING	false,
+#else
+#define NOT_DRIVING
+#endif
+
+// Batches no longer than the service's, and never past the end of the window so no sample is dropped
+static inline uint32_t nextBatchSize(const Recognizer* recognizer) {
+	uint32_t room = SAMPLE_SIZE - recognizer->dataSize;
+	return room < BATCH_SIZE ? room : BATCH_SIZE;
+}
+
+#endif
@@ -0,0 +1,414 @@
+// Sweep the recognizer's back end parameters over a cache of the front half.
+// Usage: sweep cache [-j threads] [-n] cache_file trace...
+//        sweep run [-j threads] [-s low:high:step] [-w low:high:step] [-b type=low:high:step]... cache_file
+// "cache" runs the filter, projection and feature extraction once per window of every trace and saves
+// them. "run" then replays the cache over every combination of pedometer sensitivity (-s), walking speed
+// limit (-w) and extra classifier bias per type (-b, linear classifier only), one combination per thread
+// at a time, and prints accuracy and step error for each.
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "pipeline.h"
+#include "sweep.h"
+
+#define SWEEP_MAGIC		0x57533130	// "01SW"
+#define SWEEP_VERSION	2
+#define MAX_AXES		(2 + ACTIVITY_TYPES)
+
+__thread double sweepBias[ACTIVITY_TYPES];
+
+/*
+ * Cache file: SweepHeader, SweepTrace[traceCount], SweepWindow[windowCount]. Native layout, it is not
+ * meant to leave the machine that built it.
+ */
+typedef struct {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t sampleSize;
+	uint32_t traceCount;
+	uint32_t windowCount;
+	uint32_t backend;	// CLASSIFIER_BACKEND it was built with, features differ in nothing but it is a reminder
+	uint32_t overlap;
+} SweepHeader;
+
+typedef struct {
+	uint32_t firstWindow;
+	uint32_t windowCount;
+	uint32_t truthSteps;	// TRACEFILE_NO_STEPS if the trace has none
+	uint32_t reserved;
+} SweepTrace;
+
+typedef struct {
+	Feature feature;
+	Projection window[SAMPLE_SIZE];
+	int16_t maxV;
+	int16_t minV;
+	uint32_t truth;
+} SweepWindow;
+
+// One axis of the grid
+typedef struct {
+	const char* name;
+	double low;
+	double high;
+	double step;
+	uint32_t count;
+} Axis;
+
+typedef struct {
+	double values[MAX_AXES];
+	uint64_t windows;
+	uint64_t right;
+	uint64_t steps;
+	uint64_t truthSteps;
+} Point;
+
+static uint32_t mNext;
+static uint32_t mJobCount;
+static bool mOverlap = true;
+
+// Cache building
+static const char* const* mPaths;
+static SweepTrace* mTraces;
+static SweepWindow** mWindows;
+
+// Running
+static const SweepHeader* mHeader;
+static const SweepTrace* mCachedTraces;
+static const SweepWindow* mCachedWindows;
+static Axis mAxes[MAX_AXES];
+static uint32_t mAxisCount;
+static int32_t mBiasType[MAX_AXES];	// Which type an axis biases, -1 for sensitivity and speed
+static Point* mPoints;
+
+
+static bool cacheTrace(uint32_t index) {
+	TraceFile trace;
+	if (! openTraceFile(&trace, mPaths[index]))
+		return false;
+	if (trace.header->rate != SAMPLE_RATE_HZ) {
+		fprintf(stderr, "%s: %u Hz, the recognizer is built for %u Hz\n", mPaths[index], trace.header->rate, SAMPLE_RATE_HZ);
+		closeTraceFile(&trace);
+		return false;
+	}
+
+	Recognizer recognizer;
+	initRecognizer(&recognizer);
+	setOverlap(&recognizer, mOverlap);
+	Recognizer scratch;
+	uint32_t type = 1;
+	Counter counter;
+	memset(&counter, 0, sizeof(Counter));
+	counter.timestamp = trace.header->sampleCount > 0 ? (uint32_t) (trace.samples[0].timestamp / 1000) : 0;
+
+	uint32_t capacity = (uint32_t) (trace.header->sampleCount / (SAMPLE_SIZE / 2) + 1);
+	SweepWindow* windows = malloc(capacity * sizeof(SweepWindow));
+	uint32_t count = 0;
+	uint64_t sample = 0;
+	TraceBatch batch;
+	uint32_t lastSteps = 0;
+	while (traceBatch(&trace, sample, nextBatchSize(&recognizer), &batch)) {
+		uint32_t timestamp = (uint32_t) (batch.samples[batch.count - 1].timestamp / 1000);
+		// The whole window only exists during the call: its front before, its back after the slide
+		scratch = recognizer;
+		if (analyzeAcceleration(&recognizer, &type, &counter, timestamp, NOT_DRIVING 50, (AccelData*) batch.samples, batch.count) == 0) {
+			uint32_t kept = recognizer.overlap ? SAMPLE_SIZE / 2 : 0;
+			memcpy(scratch.window + SAMPLE_SIZE - kept, recognizer.window, kept * sizeof(Projection));
+			if (! recognizer.overlap)
+				memcpy(scratch.window, recognizer.window, sizeof(scratch.window));
+			scratch.dataSize = SAMPLE_SIZE;
+
+			SweepWindow* window = &windows[count++];
+			extractFeature(&scratch, &window->feature);
+			memcpy(window->window, scratch.window, sizeof(window->window));
+			window->maxV = scratch.maxV;
+			window->minV = scratch.minV;
+			window->truth = batch.label;
+		}
+		sample += batch.count;
+		lastSteps = batch.steps;
+	}
+
+	mTraces[index].windowCount = count;
+	mTraces[index].truthSteps = trace.header->flags & TRACEFILE_STEPS ? lastSteps : TRACEFILE_NO_STEPS;
+	mWindows[index] = windows;
+	closeTraceFile(&trace);
+	return true;
+}
+
+
+static void replayPoint(Point* point) {
+	for (uint32_t i = 0; i < mAxisCount; i++) {
+		if (mBiasType[i] >= 0)
+			sweepBias[mBiasType[i]] = point->values[i];
+	}
+	int32_t sensitivity = (int32_t) point->values[0];
+	double speed = point->values[1];
+
+	for (uint32_t t = 0; t < mHeader->traceCount; t++) {
+		const SweepTrace* trace = &mCachedTraces[t];
+		Recognizer recognizer;
+		initRecognizer(&recognizer);
+		setOverlap(&recognizer, mHeader->overlap);
+		uint32_t steps = 0;
+		for (uint32_t i = 0; i < trace->windowCount; i++) {
+			const SweepWindow* window = &mCachedWindows[trace->firstWindow + i];
+			Feature feature = window->feature;
+			uint32_t type = smoothType(&recognizer, classify(feature));
+
+			// As in analyzeAcceleration, with the speed limit as a parameter
+			if (type == 2 || type == 3) {
+				memcpy(recognizer.window, window->window, sizeof(recognizer.window));
+				recognizer.maxV = window->maxV;
+				recognizer.minV = window->minV;
+				uint32_t windowSteps = countSteps(&recognizer, &feature, type, sensitivity);
+				if (type == 2) {
+					bool vibrating = feature.cadenceStrength >= CADENCE_MIN_STRENGTH && feature.cadence > speed;
+					if (windowSteps > windowHop(&recognizer) * speed || vibrating) {
+						type = 4;
+						windowSteps = 0;
+					}
+				}
+				steps += windowSteps;
+			}
+			point->windows++;
+			if (type == window->truth)
+				point->right++;
+		}
+		if (trace->truthSteps != TRACEFILE_NO_STEPS) {
+			point->steps += steps;
+			point->truthSteps += trace->truthSteps;
+		}
+	}
+}
+
+
+static void* work(void* building) {
+	uint32_t index;
+	while ((index = __atomic_fetch_add(&mNext, 1, __ATOMIC_RELAXED)) < mJobCount) {
+		if (building) {
+			cacheTrace(index);
+		} else {
+			replayPoint(&mPoints[index]);
+		}
+	}
+	return NULL;
+}
+
+
+static void runPool(uint32_t threads, bool building) {
+	mNext = 0;
+	if (threads > mJobCount)
+		threads = mJobCount;
+	pthread_t* pool = calloc(threads, sizeof(pthread_t));
+	for (uint32_t i = 0; i < threads; i++) {
+		pthread_create(&pool[i], NULL, &work, building ? (void*) 1 : NULL);
+	}
+	for (uint32_t i = 0; i < threads; i++) {
+		pthread_join(pool[i], NULL);
+	}
+	free(pool);
+}
+
+
+static int buildCache(uint32_t threads, const char* path, const char* const* paths, uint32_t count) {
+	mPaths = paths;
+	mJobCount = count;
+	mTraces = calloc(count, sizeof(SweepTrace));
+	mWindows = calloc(count, sizeof(SweepWindow*));
+	runPool(threads, true);
+
+	SweepHeader header = { SWEEP_MAGIC, SWEEP_VERSION, SAMPLE_SIZE, count, 0, CLASSIFIER_BACKEND, mOverlap };
+	for (uint32_t i = 0; i < count; i++) {
+		if (mWindows[i] == NULL)
+			return 1;
+		mTraces[i].firstWindow = header.windowCount;
+		header.windowCount += mTraces[i].windowCount;
+	}
+
+	FILE* file = fopen(path, "wb");
+	if (file == NULL) {
+		perror(path);
+		return 1;
+	}
+	fwrite(&header, sizeof(header), 1, file);
+	fwrite(mTraces, sizeof(SweepTrace), count, file);
+	for (uint32_t i = 0; i < count; i++) {
+		fwrite(mWindows[i], sizeof(SweepWindow), mTraces[i].windowCount, file);
+		free(mWindows[i]);
+	}
+	if (fclose(file) != 0) {
+		perror(path);
+		return 1;
+	}
+	fprintf(stderr, "%u windows of %u traces, %.1f MB\n", header.windowCount, count,
+			(sizeof(header) + count * sizeof(SweepTrace) + (double) header.windowCount * sizeof(SweepWindow)) / 1e6);
+	return 0;
+}
+
+
+static bool parseAxis(Axis* axis, const char* name, const char* text) {
+	axis->name = name;
+	int fields = sscanf(text, "%lf:%lf:%lf", &axis->low, &axis->high, &axis->step);
+	if (fields == 1) {
+		axis->high = axis->low;
+		axis->step = 1;
+	} else if (fields != 3 || axis->step <= 0 || axis->high < axis->low) {
+		return false;
+	}
+	axis->count = (uint32_t) ((axis->high - axis->low) / axis->step + 1e-9) + 1;
+	return true;
+}
+
+
+static int runSweep(uint32_t threads, const char* path) {
+	int file = open(path, O_RDONLY);
+	struct stat status;
+	if (file < 0 || fstat(file, &status) < 0) {
+		perror(path);
+		return 1;
+	}
+	const uint8_t* map = mmap(NULL, (size_t) status.st_size, PROT_READ, MAP_SHARED, file, 0);
+	close(file);
+	if (map == MAP_FAILED) {
+		perror(path);
+		return 1;
+	}
+	mHeader = (const SweepHeader*) map;
+	if (mHeader->magic != SWEEP_MAGIC || mHeader->version != SWEEP_VERSION || mHeader->sampleSize != SAMPLE_SIZE
+			|| sizeof(SweepHeader) + mHeader->traceCount * sizeof(SweepTrace) + (uint64_t) mHeader->windowCount * sizeof(SweepWindow) != (uint64_t) status.st_size) {
+		fprintf(stderr, "%s: not a sweep cache of this build\n", path);
+		return 1;
+	}
+	if (mHeader->backend != CLASSIFIER_BACKEND)
+		fprintf(stderr, "%s: cached with classifier backend %u\n", path, mHeader->backend);
+	mCachedTraces = (const SweepTrace*) (map + sizeof(SweepHeader));
+	mCachedWindows = (const SweepWindow*) (mCachedTraces + mHeader->traceCount);
+
+	// Every combination, the first axis changing slowest
+	mJobCount = 1;
+	for (uint32_t i = 0; i < mAxisCount; i++) {
+		mJobCount *= mAxes[i].count;
+	}
+	mPoints = calloc(mJobCount, sizeof(Point));
+	for (uint32_t p = 0; p < mJobCount; p++) {
+		uint32_t rest = p;
+		for (int32_t i = (int32_t) mAxisCount - 1; i >= 0; i--) {
+			mPoints[p].values[i] = mAxes[i].low + (rest % mAxes[i].count) * mAxes[i].step;
+			rest /= mAxes[i].count;
+		}
+	}
+
+	struct timespec began, ended;
+	clock_gettime(CLOCK_MONOTONIC, &began);
+	runPool(threads, false);
+	clock_gettime(CLOCK_MONOTONIC, &ended);
+
+	for (uint32_t i = 0; i < mAxisCount; i++) {
+		printf("%s,", mAxes[i].name);
+	}
+	printf("windows,accuracy,steps,truth_steps,step_error\n");
+	uint32_t best = 0;
+	for (uint32_t p = 0; p < mJobCount; p++) {
+		Point* point = &mPoints[p];
+		for (uint32_t i = 0; i < mAxisCount; i++) {
+			printf("%g,", point->values[i]);
+		}
+		printf("%llu,%.4f,%llu,%llu,%.4f\n", (unsigned long long) point->windows, point->windows > 0 ? (double) point->right / point->windows : 0,
+				(unsigned long long) point->steps, (unsigned long long) point->truthSteps,
+				point->truthSteps > 0 ? ((double) point->steps - point->truthSteps) / point->truthSteps : 0);
+		if (point->right > mPoints[best].right)
+			best = p;
+	}
+
+	double seconds = (ended.tv_sec - began.tv_sec) + (ended.tv_nsec - began.tv_nsec) / 1e9;
+	fprintf(stderr, "%u points over %u windows in %.2f s, best accuracy %.4f at", mJobCount, mHeader->windowCount, seconds,
+			mPoints[best].windows > 0 ? (double) mPoints[best].right / mPoints[best].windows : 0);
+	for (uint32_t i = 0; i < mAxisCount; i++) {
+		fprintf(stderr, " %s=%g", mAxes[i].name, mPoints[best].values[i]);
+	}
+	fprintf(stderr, "\n");
+	return 0;
+}
+
+
+static void usage() {
+	fprintf(stderr, "usage: sweep cache [-j threads] [-n] cache_file trace...\n");
+	fprintf(stderr, "       sweep run [-j threads] [-s low:high:step] [-w low:high:step] [-b type=low:high:step]... cache_file\n");
+}
+
+
+int main(int argc, char** argv) {
+	static char* const BIAS_NAMES[ACTIVITY_TYPES] = { "bias0", "bias1", "bias2", "bias3", "bias4" };
+	if (argc < 2) {
+		usage();
+		return 1;
+	}
+	bool building = strcmp(argv[1], "cache") == 0;
+	if (! building && strcmp(argv[1], "run") != 0) {
+		usage();
+		return 1;
+	}
+
+	uint32_t threads = (uint32_t) sysconf(_SC_NPROCESSORS_ONLN);
+	parseAxis(&mAxes[0], "sensitivity", "50");
+	parseAxis(&mAxes[1], "speed", "3");
+	mAxes[1].low = mAxes[1].high = MAX_WALKING_SPEED;
+	mBiasType[0] = mBiasType[1] = -1;
+	mAxisCount = 2;
+
+	int option;
+	optind = 2;
+	while ((option = getopt(argc, argv, "j:ns:w:b:")) != -1) {
+		switch (option) {
+			case 'j':
+				threads = (uint32_t) atoi(optarg);
+				break;
+			case 'n':
+				mOverlap = false;
+				break;
+			case 's':
+				if (! parseAxis(&mAxes[0], "sensitivity", optarg)) {
+					usage();
+					return 1;
+				}
+				break;
+			case 'w':
+				if (! parseAxis(&mAxes[1], "speed", optarg)) {
+					usage();
+					return 1;
+				}
+				break;
+			case 'b': {
+				// One axis per type at most, so mAxes always has room
+				uint32_t type = (uint32_t) (optarg[0] - '0');
+				for (uint32_t i = 2; i < mAxisCount; i++) {
+					if (mBiasType[i] == (int32_t) type) {
+						fprintf(stderr, "-b %u given twice\n", type);
+						return 1;
+					}
+				}
+				if (CLASSIFIER_BACKEND != CLASSIFIER_LINEAR || mAxisCount >= MAX_AXES || type >= ACTIVITY_TYPES
+						|| optarg[1] != '=' || ! parseAxis(&mAxes[mAxisCount], BIAS_NAMES[type], optarg + 2)) {
+					fprintf(stderr, "-b type=low:high:step, for the linear classifier only\n");
+					return 1;
+				}
+				mBiasType[mAxisCount++] = (int32_t) type;
+				break;
+			}
+			default:
+				usage();
+				return 1;
+		}
+	}
+	if (threads == 0 || optind >= argc || (! building && argc - optind != 1)) {
+		usage();
+		return 1;
+	}
+	if (building)
+		return buildCache(threads, argv[optind], (const char* const*) argv + optind + 1, (uint32_t) (argc - optind - 1));
+	return runSweep(threads, argv[optind]);
+}
@@ -0,0 +1,9 @@
+#ifndef _SWEEP_H_
+#define _SWEEP_H_
+
+// Forced into every file of the sweep build, so that the linear classifier adds each thread's own biases.
+// sweep.c sizes it, with ACTIVITY_TYPES from recognizer.h which is not included yet here.
+extern __thread double sweepBias[];
+#define CLASSIFIER_BIAS(type)	sweepBias[type]
+
+#endif
@@ -0,0 +1,155 @@
+// Generate a multi-day accelerometer trace with ground truth labels and steps.
+// Usage: synthesize [-s seed] [-d days] [-t start_ms] [-N] [-w weights] [-p name=low:high]... output
+// output is a trace (tracefile.h), or CSV if it ends in .csv. -N adds nights of sleep, -w weighs the
+// daytime types (sleep,sit,walk,jog,driving) and -p narrows a parameter range, e.g. -p noise=4:8.
+#include <stddef.h>
+#include <time.h>
+#include <unistd.h>
+#include "generator.h"
+#include "tracefile.h"
+
+#define BATCH	256
+
+static const char* const LABELS[] = TRACEFILE_ACTIVITY_LABELS;
+
+static const struct {
+	const char* name;
+	size_t offset;
+} RANGES[] = {
+	{ "seconds", offsetof(GeneratorConfig, seconds) },
+	{ "walkCadence", offsetof(GeneratorConfig, walkCadence) },
+	{ "walkBounce", offsetof(GeneratorConfig, walkBounce) },
+	{ "walkSwing", offsetof(GeneratorConfig, walkSwing) },
+	{ "jogCadence", offsetof(GeneratorConfig, jogCadence) },
+	{ "jogBounce", offsetof(GeneratorConfig, jogBounce) },
+	{ "jogSwing", offsetof(GeneratorConfig, jogSwing) },
+	{ "vibration", offsetof(GeneratorConfig, vibration) },
+	{ "fidget", offsetof(GeneratorConfig, fidget) },
+	{ "gesture", offsetof(GeneratorConfig, gesture) },
+	{ "tilt", offsetof(GeneratorConfig, tilt) },
+	{ "sleepTilt", offsetof(GeneratorConfig, sleepTilt) },
+	{ "noise", offsetof(GeneratorConfig, noise) }
+};
+#define RANGE_COUNT	(sizeof(RANGES) / sizeof(RANGES[0]))
+
+
+static bool setRange(GeneratorConfig* config, const char* argument) {
+	for (uint32_t i = 0; i < RANGE_COUNT; i++) {
+		size_t length = strlen(RANGES[i].name);
+		if (strncmp(argument, RANGES[i].name, length) == 0 && argument[length] == '=') {
+			Range* range = (Range*) ((uint8_t*) config + RANGES[i].offset);
+			return sscanf(argument + length + 1, "%lf:%lf", &range->low, &range->high) == 2;
+		}
+	}
+	return false;
+}
+
+
+static void usage() {
+	fprintf(stderr, "usage: synthesize [-s seed] [-d days] [-t start_ms] [-N] [-w weights] [-p name=low:high]... output\n");
+	fprintf(stderr, "ranges:");
+	for (uint32_t i = 0; i < RANGE_COUNT; i++) {
+		fprintf(stderr, " %s", RANGES[i].name);
+	}
+	fprintf(stderr, "\n");
+}
+
+
+int main(int argc, char** argv) {
+	GeneratorConfig config;
+	defaultGeneratorConfig(&config);
+	uint32_t seed = 1;
+	double days = 1;
+	uint64_t start = 1451606400000ULL;	// 2016-01-01 00:00 UTC
+	int option;
+	while ((option = getopt(argc, argv, "s:d:t:Nw:p:")) != -1) {
+		switch (option) {
+			case 's':
+				seed = (uint32_t) strtoul(optarg, NULL, 10);
+				break;
+			case 'd':
+				days = atof(optarg);
+				break;
+			case 't':
+				start = strtoull(optarg, NULL, 10);
+				break;
+			case 'N':
+				config.nights = true;
+				break;
+			case 'w':
+				if (sscanf(optarg, "%u,%u,%u,%u,%u", &config.weights[0], &config.weights[1], &config.weights[2],
+						&config.weights[3], &config.weights[4]) != GENERATOR_TYPES) {
+					usage();
+					return 1;
+				}
+				break;
+			case 'p':
+				if (! setRange(&config, optarg)) {
+					usage();
+					return 1;
+				}
+				break;
+			default:
+				usage();
+				return 1;
+		}
+	}
+	if (argc - optind != 1) {
+		usage();
+		return 1;
+	}
+	const char* path = argv[optind];
+	size_t length = strlen(path);
+	bool csv = length > 4 && strcmp(path + length - 4, ".csv") == 0;
+
+	TraceWriter writer;
+	FILE* output = NULL;
+	if (csv) {
+		output = fopen(path, "w");
+		if (output == NULL) {
+			perror(path);
+			return 1;
+		}
+		fprintf(output, "timestamp,x,y,z,vibrate,label,steps\n");
+	} else if (! openTraceWriter(&writer, path, config.rate, "synthetic", LABELS, TRACEFILE_ACTIVITY_COUNT)) {
+		return 1;
+	}
+
+	Generator generator;
+	initGenerator(&generator, &config, seed, start);
+	uint64_t total = (uint64_t) (days * 86400 * config.rate);
+	uint64_t perType[GENERATOR_TYPES] = { 0 };
+	AccelData samples[BATCH];
+	uint64_t steps[BATCH];
+	struct timespec began, ended;
+	clock_gettime(CLOCK_MONOTONIC, &began);
+	for (uint64_t done = 0; done < total; ) {
+		uint32_t count = generate(&generator, samples, steps, total - done < BATCH ? (uint32_t) (total - done) : BATCH);
+		if (csv) {
+			for (uint32_t i = 0; i < count; i++) {
+				fprintf(output, "%llu,%d,%d,%d,%d,%u,%llu\n", (unsigned long long) samples[i].timestamp, samples[i].x,
+						samples[i].y, samples[i].z, samples[i].did_vibrate, generator.label, (unsigned long long) steps[i]);
+			}
+		} else {
+			// One at a time, so blocks end with their own step count
+			for (uint32_t i = 0; i < count; i++) {
+				if (! writeTraceSamples(&writer, &samples[i], 1, generator.label, (uint32_t) steps[i]))
+					return 1;
+			}
+		}
+		perType[generator.label] += count;
+		done += count;
+	}
+	bool ok = csv ? fclose(output) == 0 : closeTraceWriter(&writer);
+	clock_gettime(CLOCK_MONOTONIC, &ended);
+
+	double seconds = (ended.tv_sec - began.tv_sec) + (ended.tv_nsec - began.tv_nsec) / 1e9;
+	fprintf(stderr, "%llu samples (%.1f days), %llu steps in %.2f s, %.1f M samples/s\n", (unsigned long long) total,
+			(double) total / config.rate / 86400, (unsigned long long) generator.steps, seconds, total / seconds / 1e6);
+	fprintf(stderr, "time per type:");
+	for (uint32_t i = 0; i < GENERATOR_TYPES; i++) {
+		fprintf(stderr, " %s %.1f%%", LABELS[i], 100.0 * perType[i] / (total > 0 ? total : 1));
+	}
+	fprintf(stderr, "\n");
+	return ok ? 0 : 1;
+}
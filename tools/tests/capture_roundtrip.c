@@ -0,0 +1,98 @@
+// Encode a made-up walk and run with the worker's capture code, decode it back and compare every field.
+// Also writes the stream to a file for capture_decode and reports the size against raw AccelData.
+#include "host.h"
+#include "capture.h"
+#include "capture_reader.h"
+
+#define SAMPLE_COUNT	20000
+#define BATCH			10
+
+static uint8_t mStream[SAMPLE_COUNT * sizeof(AccelData)];
+static size_t mStreamSize;
+static AccelData mSamples[SAMPLE_COUNT];
+static uint8_t mLabels[SAMPLE_COUNT];
+static Capture mCapture;
+
+
+static void dataLogged(uint32_t tag, const uint8_t* data, uint32_t itemLength, uint32_t numItems) {
+	if (tag != CAPTURE_DATA_LOG_TAG)
+		return;
+	memcpy(mStream + mStreamSize, data, itemLength * numItems);
+	mStreamSize += itemLength * numItems;
+}
+
+
+static uint32_t mSeed = 11;
+
+
+static int32_t noise(int32_t amplitude) {
+	mSeed = mSeed * 1103515245 + 12345;
+	return (int32_t) ((mSeed >> 16) % (2 * amplitude + 1)) - amplitude;
+}
+
+
+int main(int argc, char** argv) {
+	hostSetDataLogHook(&dataLogged);
+
+	// Walking, then jogging for the last quarter: gravity mostly on z, a bounce at step cadence, arm swing
+	// at half of it and sensor noise. On top, what the real accelerometer adds: timing jitter, the odd long
+	// gap and vibration flags.
+	uint64_t timestamp = 1451635200000ULL;
+	uint32_t phase = 0;
+	startCapture(&mCapture);
+	for (uint32_t i = 0; i < SAMPLE_COUNT; i += BATCH) {
+		uint32_t label = i < SAMPLE_COUNT * 3 / 4 ? 2 : 3;
+		int32_t bounce = label == 2 ? 300 : 700;
+		for (uint32_t j = i; j < i + BATCH; j++) {
+			phase += TRIG_MAX_ANGLE * (label == 2 ? 110 : 160) / 600;
+			mSamples[j].x = (int16_t) (200 * sin_lookup(phase / 2) / TRIG_MAX_RATIO + noise(20));
+			mSamples[j].y = (int16_t) (150 + noise(20));
+			mSamples[j].z = (int16_t) (-980 + bounce * sin_lookup(phase) / TRIG_MAX_RATIO + noise(20));
+			if (j % 4999 == 4998)
+				timestamp += 90000;
+			timestamp += 100;
+			mSamples[j].timestamp = timestamp + 3 + noise(3);
+			mSamples[j].did_vibrate = (j / 40) % 25 == 0;
+			mLabels[j] = (uint8_t) label;
+		}
+		captureSamples(&mCapture, mSamples + i, BATCH, label);
+	}
+	stopCapture(&mCapture);
+
+	CaptureReader reader;
+	if (! initCaptureReader(&reader, mStream, mStreamSize) || reader.rate != 1000 / CAPTURE_INTERVAL_MS) {
+		fprintf(stderr, "bad preamble\n");
+		return 1;
+	}
+	uint32_t decoded = 0;
+	uint32_t labels = 0;
+	AccelData block[CAPTURE_BLOCK_SIZE];
+	uint8_t label;
+	int32_t count;
+	while ((count = readCaptureBlock(&reader, block, &label)) > 0) {
+		for (int32_t i = 0; i < count; i++, decoded++) {
+			AccelData* expected = &mSamples[decoded];
+			if (decoded >= SAMPLE_COUNT || block[i].x != expected->x || block[i].y != expected->y || block[i].z != expected->z
+					|| block[i].timestamp != expected->timestamp || block[i].did_vibrate != expected->did_vibrate
+					|| label != mLabels[decoded]) {
+				fprintf(stderr, "sample %u differs\n", decoded);
+				return 1;
+			}
+			if (decoded > 0 && mLabels[decoded] != mLabels[decoded - 1])
+				labels++;
+		}
+	}
+	if (count < 0 || decoded != SAMPLE_COUNT || labels == 0) {
+		fprintf(stderr, "decoded %u of %u samples, %u label changes\n", decoded, SAMPLE_COUNT, labels);
+		return 1;
+	}
+
+	FILE* output = fopen(argv[1], "wb");
+	fwrite(mStream, 1, mStreamSize, output);
+	fclose(output);
+
+	double perSample = (double) mStreamSize / SAMPLE_COUNT;
+	printf("capture: %u samples, %zu bytes, %.2f bytes per sample, %.1fx smaller than AccelData (%zu bytes)\n",
+			SAMPLE_COUNT, mStreamSize, perSample, sizeof(AccelData) / perSample, sizeof(AccelData));
+	return 0;
+}
@@ -0,0 +1,98 @@
+// The portable kernels against the double arithmetic they replaced in projectSample and extractFeature:
+// random and extreme windows of every length up to two windows, and random accelerometer vectors
+#include "host.h"
+#include "kernels.h"
+#include "sampling.h"
+
+#define CHECK(condition) \
+	do { \
+		if (! (condition)) { \
+			fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #condition); \
+			return 1; \
+		} \
+	} while (0)
+
+#define ACCEL_RANGE	4000	// mG, the sensor's range
+#define VECTORS	100000
+
+static uint32_t mRandom = 1;
+
+
+static uint32_t nextRandom() {
+	mRandom ^= mRandom << 13;
+	mRandom ^= mRandom >> 17;
+	mRandom ^= mRandom << 5;
+	return mRandom;
+}
+
+
+static int16_t randomIn(int32_t low, int32_t high) {
+	return (int16_t) (low + (int32_t) (nextRandom() % (uint32_t) (high - low + 1)));
+}
+
+
+// The old feature sums, accumulated in doubles
+static bool matchesDoubles(const Projection* window, uint32_t size) {
+	double meanV = 0.0, meanH = 0.0, deviationV = 0.0, deviationH = 0.0;
+	for (uint32_t i = 0; i < size; i++) {
+		double v = window[i].v;
+		double h = window[i].h;
+		meanV += v;
+		meanH += h;
+		deviationV += v * v;
+		deviationH += h * h;
+	}
+
+	Moments moments;
+	sumMoments(window, size, &moments);
+	return moments.sumV == meanV && moments.sumH == meanH && moments.squaresV == deviationV && moments.squaresH == deviationH;
+}
+
+
+int main() {
+	Projection window[2 * SAMPLE_SIZE];
+	CHECK(sizeof(Projection) == sizeof(uint32_t));
+
+	// Every length, odd ones leave a sample for the tail loop on M4
+	for (uint32_t size = 0; size <= 2 * SAMPLE_SIZE; size++) {
+		for (uint32_t round = 0; round < 50; round++) {
+			for (uint32_t i = 0; i < size; i++) {
+				window[i].v = randomIn(-ACCEL_RANGE, ACCEL_RANGE);
+				window[i].h = randomIn(0, ACCEL_RANGE);
+			}
+			CHECK(matchesDoubles(window, size));
+		}
+	}
+
+	// The ends of the int16 range, where a sign or carry slip between the halves would show
+	const int16_t extremes[] = { INT16_MIN, INT16_MIN + 1, -1, 0, 1, INT16_MAX };
+	const uint32_t count = sizeof(extremes) / sizeof(extremes[0]);
+	for (uint32_t round = 0; round < 1000; round++) {
+		for (uint32_t i = 0; i < 2 * SAMPLE_SIZE; i++) {
+			window[i].v = extremes[nextRandom() % count];
+			window[i].h = extremes[nextRandom() % count];
+		}
+		CHECK(matchesDoubles(window, SAMPLE_SIZE));
+		CHECK(matchesDoubles(window, 2 * SAMPLE_SIZE - 1));
+	}
+	for (uint32_t i = 0; i < SAMPLE_SIZE; i++) {
+		window[i].v = INT16_MIN;
+		window[i].h = INT16_MAX;
+	}
+	CHECK(matchesDoubles(window, SAMPLE_SIZE));
+
+	// Linear acceleration against gravity and itself, as projectSample takes them
+	for (uint32_t i = 0; i < VECTORS; i++) {
+		int16_t gx = randomIn(-ACCEL_RANGE, ACCEL_RANGE);
+		int16_t gy = randomIn(-ACCEL_RANGE, ACCEL_RANGE);
+		int16_t gz = randomIn(-ACCEL_RANGE, ACCEL_RANGE);
+		int16_t x = randomIn(-2 * ACCEL_RANGE, 2 * ACCEL_RANGE);
+		int16_t y = randomIn(-2 * ACCEL_RANGE, 2 * ACCEL_RANGE);
+		int16_t z = randomIn(-2 * ACCEL_RANGE, 2 * ACCEL_RANGE);
+		CHECK(dotProduct(x, y, z, gx, gy, gz) == x * (double) gx + y * (double) gy + z * (double) gz);
+		CHECK(dotProduct(x, y, z, x, y, z) == (double) x * x + (double) y * y + (double) z * z);
+	}
+
+	printf("kernels match the double sums\n");
+	return 0;
+}
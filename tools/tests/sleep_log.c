@@ -0,0 +1,73 @@
+// Night mode's sleep log: restless epochs are logged and counted as sitting, short trips out of night mode
+// stay in the same night, long ones start a new one
+#include "host.h"
+#include "actigraphy.h"
+
+#define CHECK(condition) \
+	do { \
+		if (! (condition)) { \
+			fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #condition); \
+			return 1; \
+		} \
+	} while (0)
+
+static Actigraphy mActigraphy;
+static SleepLog mLog;
+static Counter mCounter;
+static uint32_t mNow = 1451606400;
+
+
+// A minute of samples around 1 g, swinging by amplitude mG from one sample to the next
+static uint32_t playEpoch(int16_t amplitude) {
+	uint32_t result = 2;
+	for (uint32_t batch = 0; batch < SLEEP_EPOCH_SAMPLES / 10; batch++) {
+		AccelData samples[10];
+		for (uint32_t i = 0; i < 10; i++) {
+			samples[i] = (AccelData) { 0, 0, (int16_t) (-1000 + (i % 2 ? amplitude : -amplitude)), false, 0 };
+		}
+		mNow++;
+		result = trackSleep(&mActigraphy, &mLog, &mCounter, mNow * (10 * SLEEP_EPOCH_S / SLEEP_EPOCH_SAMPLES), samples, 10);
+	}
+	return result;
+}
+
+
+int main() {
+	CHECK(sizeof(SleepLog) <= PERSIST_DATA_MAX_LENGTH);
+	initSleepLog(&mLog);
+	mCounter.timestamp = mNow;
+	for (uint32_t i = 0; i < SLEEP_ENTRY_WINDOWS; i++) {
+		noteActivity(&mActigraphy, 0);
+	}
+	CHECK(isSleeping(&mActigraphy));
+
+	// Ten quiet minutes, two restless ones, ten quiet again
+	for (uint32_t i = 0; i < 10; i++) {
+		CHECK(playEpoch(5) == 0);
+	}
+	uint32_t sleepTime = mCounter.sleepTime;
+	CHECK(playEpoch(45) == 0);
+	CHECK(playEpoch(45) == 0);
+	CHECK(mCounter.sleepTime == sleepTime);
+	CHECK(mCounter.sitTime == 2 * SLEEP_EPOCH_S);
+	for (uint32_t i = 0; i < 10; i++) {
+		CHECK(playEpoch(5) == 0);
+	}
+	CHECK(mLog.night.epochs == 22 && mLog.night.wakeEpochs == 2 && mLog.night.wakeBouts == 1 && mLog.night.longestBout == 2);
+	CHECK(! isWakeEpoch(&mLog, 9) && isWakeEpoch(&mLog, 10) && isWakeEpoch(&mLog, 11) && ! isWakeEpoch(&mLog, 12));
+	CHECK(mLog.night.start == mNow - 22 * SLEEP_EPOCH_S);
+
+	// Up for nine minutes, then a quiet epoch: the same night, the gap is awake
+	mNow += 10 * SLEEP_EPOCH_S;
+	logEpoch(&mLog, mNow, false);
+	CHECK(mLog.night.epochs == 32 && mLog.night.wakeEpochs == 11 && mLog.night.wakeBouts == 2 && mLog.night.longestBout == 9);
+
+	// Up for a day: a new night, the last one kept as a summary
+	mNow += 86400;
+	logEpoch(&mLog, mNow, false);
+	CHECK(mLog.night.epochs == 1 && mLog.night.wakeEpochs == 0 && ! isWakeEpoch(&mLog, 10));
+	CHECK(mLog.nights[mLog.nightSlot].epochs == 32 && mLog.nights[mLog.nightSlot].wakeEpochs == 11);
+
+	printf("sleep log: %zu bytes, wake epochs logged and counted as sitting\n", sizeof(SleepLog));
+	return 0;
+}
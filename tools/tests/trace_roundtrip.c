@@ -0,0 +1,41 @@
+// Fill the ring past its size, drain it through data logging into a file for trace_decode
+#include "host.h"
+#include "trace.h"
+
+static FILE* mOutput;
+
+
+// A day ahead of the wall clock, like a fast-forwarded worker
+static uint64_t simulatedClock() {
+	return 1451635200000ULL + 86400000ULL + 250;
+}
+
+
+static void dataLogged(uint32_t tag, const uint8_t* data, uint32_t itemLength, uint32_t numItems) {
+	if (tag == TRACE_DATA_LOG_TAG)
+		fwrite(data, itemLength, numItems, mOutput);
+}
+
+
+int main(int argc, char** argv) {
+	mOutput = fopen(argv[1], "wb");
+	hostSetDataLogHook(&dataLogged);
+	hostSetTime(1451635200000ULL);
+
+	// Only the last TRACE_SIZE survive
+	for (int32_t i = 0; i < TRACE_SIZE + 3; i++) {
+		trace(TRACE_CLASS, 2 | 1 << 8 | 4 << 16, i);
+		hostSetTime(hostNow() + 4000);
+	}
+	trace(TRACE_POWER, 2, 20);
+	drainTrace();
+	drainTrace();	// Empty, logs nothing
+
+	// The worker's own clock replaces the wall clock
+	setTraceClock(&simulatedClock);
+	trace(TRACE_POWER, 3, 10);
+	drainTrace();
+
+	fclose(mOutput);
+	return 0;
+}
@@ -0,0 +1,108 @@
+// Write a made-up trace with gaps and label changes, map it back and check batch views and seeking
+#include "tracefile.h"
+
+#define SAMPLE_COUNT	50000
+#define BATCH			10
+#define RATE			10
+#define SEGMENT			1200	// Samples of one activity
+
+static AccelData mSamples[SAMPLE_COUNT];
+static uint8_t mLabels[SAMPLE_COUNT];
+static const char* const LABELS[] = TRACEFILE_ACTIVITY_LABELS;
+
+
+// What seekTrace must return, the slow way
+static uint64_t scan(uint64_t timestamp) {
+	for (uint64_t i = 0; i < SAMPLE_COUNT; i++) {
+		if (mSamples[i].timestamp >= timestamp)
+			return i;
+	}
+	return SAMPLE_COUNT;
+}
+
+
+int main(int argc, char** argv) {
+	TraceWriter writer;
+	if (! openTraceWriter(&writer, argv[1], RATE, "aplite", LABELS, TRACEFILE_ACTIVITY_COUNT))
+		return 1;
+	// Sitting, walking, jogging and sleeping in turn, a step every third sample on the move
+	uint32_t seed = 5;
+	uint64_t timestamp = 1451635200000ULL;
+	uint32_t steps = 0;
+	for (uint32_t i = 0; i < SAMPLE_COUNT; i += BATCH) {
+		uint32_t label = (i / SEGMENT + 1) % 4;
+		// Now and then the watch stops sampling for a while
+		if (i % 7000 == 6990)
+			timestamp += 3600000;
+		for (uint32_t j = i; j < i + BATCH; j++) {
+			seed = seed * 1103515245 + 12345;
+			mSamples[j].x = (int16_t) (seed >> 16);
+			mSamples[j].y = (int16_t) (seed >> 8);
+			mSamples[j].z = (int16_t) -1000;
+			mSamples[j].did_vibrate = false;
+			mSamples[j].timestamp = timestamp;
+			timestamp += 1000 / RATE;
+			mLabels[j] = (uint8_t) label;
+			if ((label == 2 || label == 3) && j % 3 == 0)
+				steps++;
+		}
+		writeTraceSamples(&writer, mSamples + i, BATCH, label, steps);
+	}
+	if (! closeTraceWriter(&writer))
+		return 1;
+
+	TraceFile trace;
+	if (! openTraceFile(&trace, argv[1]))
+		return 1;
+	if (trace.header->sampleCount != SAMPLE_COUNT || trace.header->rate != RATE || strcmp(trace.labels[2], "walk") != 0) {
+		fprintf(stderr, "bad header\n");
+		return 1;
+	}
+
+	// Every batch is a window onto the mapping and matches what went in
+	uint64_t sample = 0;
+	TraceBatch batch;
+	uint32_t lastSteps = 0;
+	while (traceBatch(&trace, sample, 80, &batch)) {
+		if ((const uint8_t*) batch.samples < trace.map || (const uint8_t*) (batch.samples + batch.count) > trace.map + trace.size
+				|| batch.steps < lastSteps) {
+			fprintf(stderr, "bad batch at %llu\n", (unsigned long long) sample);
+			return 1;
+		}
+		for (uint32_t i = 0; i < batch.count; i++, sample++) {
+			const AccelData* s = &batch.samples[i];
+			if (s->x != mSamples[sample].x || s->y != mSamples[sample].y || s->z != mSamples[sample].z
+					|| s->timestamp != mSamples[sample].timestamp || batch.label != mLabels[sample]) {
+				fprintf(stderr, "sample %llu differs\n", (unsigned long long) sample);
+				return 1;
+			}
+		}
+		lastSteps = batch.steps;
+	}
+	if (sample != SAMPLE_COUNT || lastSteps != steps) {
+		fprintf(stderr, "read %llu samples, %u steps\n", (unsigned long long) sample, lastSteps);
+		return 1;
+	}
+
+	// Seeking: on samples, between them, in the gaps and off both ends
+	seed = 1;
+	uint64_t start = mSamples[0].timestamp;
+	uint64_t span = mSamples[SAMPLE_COUNT - 1].timestamp - start;
+	for (uint32_t i = 0; i < 2000; i++) {
+		seed = seed * 1103515245 + 12345;
+		uint64_t timestamp = start - 1000 + (uint64_t) seed * (span + 2000) / UINT32_MAX;
+		if (seekTrace(&trace, timestamp) != scan(timestamp)) {
+			fprintf(stderr, "seek to %llu\n", (unsigned long long) timestamp);
+			return 1;
+		}
+	}
+	for (uint32_t i = 0; i < SAMPLE_COUNT; i += 997) {
+		if (seekTrace(&trace, mSamples[i].timestamp) != i) {
+			fprintf(stderr, "seek to sample %u\n", i);
+			return 1;
+		}
+	}
+	printf("tracefile: %u samples in %u blocks, batches and seeks match\n", SAMPLE_COUNT, trace.header->blockCount);
+	closeTraceFile(&trace);
+	return 0;
+}
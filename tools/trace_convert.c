@@ -0,0 +1,125 @@
+// Convert a capture stream or a CSV trace into the binary trace container (tracefile.h).
+// Usage: trace_convert [-m model] [-r rate] input output
+// A capture is told apart by its preamble. CSV needs a header naming its columns: timestamp, x, y, z and
+// optionally vibrate, label and steps, in any order; capture_decode's output is one such file.
+#include <unistd.h>
+#include "capture_reader.h"
+#include "loadfile.h"
+#include "tracefile.h"
+
+static const char* const LABELS[] = TRACEFILE_ACTIVITY_LABELS;
+
+enum { TIMESTAMP, X, Y, Z, VIBRATE, LABEL, STEPS, COLUMN_COUNT };
+static const char* const COLUMNS[] = { "timestamp", "x", "y", "z", "vibrate", "label", "steps" };
+
+
+static bool convertCapture(const uint8_t* bytes, size_t size, TraceWriter* writer) {
+	CaptureReader reader;
+	initCaptureReader(&reader, bytes, size);
+	AccelData samples[CAPTURE_BLOCK_SIZE];
+	uint8_t label;
+	int32_t count;
+	while ((count = readCaptureBlock(&reader, samples, &label)) > 0) {
+		if (! writeTraceSamples(writer, samples, (uint32_t) count, label, TRACEFILE_NO_STEPS))
+			return false;
+	}
+	if (count < 0)
+		fprintf(stderr, "capture cut short at byte %zu\n", reader.offset);
+	return count == 0;
+}
+
+
+static bool convertCsv(char* text, TraceWriter* writer) {
+	// Where each known column sits, -1 if it is missing
+	int32_t positions[COLUMN_COUNT];
+	for (uint32_t i = 0; i < COLUMN_COUNT; i++) {
+		positions[i] = -1;
+	}
+	char* line = strsep(&text, "\n");
+	int32_t fields = 0;
+	for (char* name; (name = strsep(&line, ",\r")) != NULL; fields++) {
+		for (uint32_t i = 0; i < COLUMN_COUNT; i++) {
+			if (strcmp(name, COLUMNS[i]) == 0)
+				positions[i] = fields;
+		}
+	}
+	if (positions[TIMESTAMP] < 0 || positions[X] < 0 || positions[Y] < 0 || positions[Z] < 0) {
+		fprintf(stderr, "CSV header needs timestamp, x, y and z\n");
+		return false;
+	}
+
+	uint64_t row = 1;
+	while ((line = strsep(&text, "\n")) != NULL) {
+		row++;
+		if (*line == '\0' || *line == '\r')
+			continue;
+		int64_t values[COLUMN_COUNT] = { 0, 0, 0, 0, 0, 0, TRACEFILE_NO_STEPS };
+		char* field = line;
+		for (int32_t i = 0; i < fields && field != NULL; i++) {
+			char* end;
+			int64_t value = strtoll(field, &end, 10);
+			for (uint32_t column = 0; column < COLUMN_COUNT; column++) {
+				if (positions[column] == i)
+					values[column] = value;
+			}
+			field = *end == ',' ? end + 1 : NULL;
+		}
+
+		AccelData sample = {
+			.x = (int16_t) values[X],
+			.y = (int16_t) values[Y],
+			.z = (int16_t) values[Z],
+			.did_vibrate = values[VIBRATE] != 0,
+			.timestamp = (uint64_t) values[TIMESTAMP]
+		};
+		if (! writeTraceSamples(writer, &sample, 1, (uint32_t) values[LABEL], (uint32_t) values[STEPS])) {
+			fprintf(stderr, "at line %llu\n", (unsigned long long) row);
+			return false;
+		}
+	}
+	return true;
+}
+
+
+int main(int argc, char** argv) {
+	const char* model = "unknown";
+	uint32_t rate = 10;
+	int option;
+	while ((option = getopt(argc, argv, "m:r:")) != -1) {
+		switch (option) {
+			case 'm':
+				model = optarg;
+				break;
+			case 'r':
+				rate = (uint32_t) atoi(optarg);
+				break;
+			default:
+				fprintf(stderr, "usage: trace_convert [-m model] [-r rate] input output\n");
+				return 1;
+		}
+	}
+	if (argc - optind != 2) {
+		fprintf(stderr, "usage: trace_convert [-m model] [-r rate] input output\n");
+		return 1;
+	}
+
+	size_t size;
+	uint8_t* bytes = loadFile(argv[optind], &size);
+	if (bytes == NULL)
+		return 1;
+	bytes = realloc(bytes, size + 1);
+	bytes[size] = '\0';
+
+	CaptureReader probe;
+	bool capture = initCaptureReader(&probe, bytes, size);
+	if (capture)
+		rate = probe.rate;
+
+	TraceWriter writer;
+	if (! openTraceWriter(&writer, argv[optind + 1], rate, model, LABELS, TRACEFILE_ACTIVITY_COUNT))
+		return 1;
+	bool ok = capture ? convertCapture(bytes, size, &writer) : convertCsv((char*) bytes, &writer);
+	ok = closeTraceWriter(&writer) && ok;
+	free(bytes);
+	return ok ? 0 : 1;
+}
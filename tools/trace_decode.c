@@ -0,0 +1,63 @@
+// Decode the worker's trace ring as drained through data logging (tag 1): 16 byte little endian events.
+// Usage: trace_decode [file], prints one CSV line per event: time,event,arg0,arg1
+#include "trace.h"
+
+static const char* NAMES[] = {
+	[TRACE_FEATURE_MEAN] = "feature_mean",
+	[TRACE_FEATURE_DEVIATION] = "feature_deviation",
+	[TRACE_FEATURE_RHYTHM] = "feature_rhythm",
+	[TRACE_CLASS] = "class",
+	[TRACE_STEPS] = "steps",
+	[TRACE_TRUTH] = "truth",
+	[TRACE_EPOCH] = "epoch",
+	[TRACE_FEATURE_CADENCE] = "feature_cadence",
+	[TRACE_SMOOTHING] = "smoothing",
+	[TRACE_FILTER_SEED] = "filter_seed",
+	[TRACE_POWER] = "power"
+};
+#define NAME_COUNT	(sizeof(NAMES) / sizeof(NAMES[0]))
+
+
+static uint32_t readLittle(const uint8_t* bytes, uint32_t size) {
+	uint32_t value = 0;
+	for (uint32_t i = 0; i < size; i++) {
+		value |= (uint32_t) bytes[i] << (8 * i);
+	}
+	return value;
+}
+
+
+int main(int argc, char** argv) {
+	FILE* file = argc > 1 ? fopen(argv[1], "rb") : stdin;
+	if (file == NULL) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	uint8_t bytes[sizeof(TraceEvent)];
+	printf("time,event,arg0,arg1\n");
+	while (fread(bytes, sizeof(bytes), 1, file) == 1) {
+		uint32_t timestamp = readLittle(bytes, 4);
+		uint32_t milliseconds = readLittle(bytes + 4, 2);
+		uint32_t id = readLittle(bytes + 6, 2);
+		int32_t arg0 = (int32_t) readLittle(bytes + 8, 4);
+		int32_t arg1 = (int32_t) readLittle(bytes + 12, 4);
+
+		printf("%u.%03u,", timestamp, milliseconds);
+		if (id < NAME_COUNT && NAMES[id] != NULL) {
+			printf("%s,", NAMES[id]);
+		} else {
+			printf("%u,", id);
+		}
+		if (id == TRACE_CLASS) {
+			// type | raw type << 8 | elapsed << 16
+			printf("type=%d raw=%d elapsed=%d,%d\n", arg0 & 0xFF, (arg0 >> 8) & 0xFF, (int) ((uint32_t) arg0 >> 16), arg1);
+		} else {
+			printf("%d,%d\n", arg0, arg1);
+		}
+	}
+
+	if (file != stdin)
+		fclose(file);
+	return 0;
+}
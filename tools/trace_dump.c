@@ -0,0 +1,59 @@
+// Print a binary trace (tracefile.h) as CSV: timestamp,x,y,z,vibrate,label
+// Usage: trace_dump [-i] [-f from_ms] [-n count] file
+// -i prints the header and block count to stderr, -f starts at the first sample at or after from_ms.
+#include <unistd.h>
+#include "tracefile.h"
+
+
+int main(int argc, char** argv) {
+	bool info = false;
+	uint64_t from = 0;
+	uint64_t limit = UINT64_MAX;
+	int option;
+	while ((option = getopt(argc, argv, "if:n:")) != -1) {
+		switch (option) {
+			case 'i':
+				info = true;
+				break;
+			case 'f':
+				from = strtoull(optarg, NULL, 10);
+				break;
+			case 'n':
+				limit = strtoull(optarg, NULL, 10);
+				break;
+			default:
+				fprintf(stderr, "usage: trace_dump [-i] [-f from_ms] [-n count] file\n");
+				return 1;
+		}
+	}
+	if (argc - optind != 1) {
+		fprintf(stderr, "usage: trace_dump [-i] [-f from_ms] [-n count] file\n");
+		return 1;
+	}
+
+	TraceFile trace;
+	if (! openTraceFile(&trace, argv[optind]))
+		return 1;
+	if (info) {
+		fprintf(stderr, "model %.16s, %u Hz, %llu samples in %u blocks, labels", trace.header->model, trace.header->rate,
+				(unsigned long long) trace.header->sampleCount, trace.header->blockCount);
+		for (uint32_t i = 0; i < trace.header->labelCount; i++) {
+			fprintf(stderr, " %u=%.16s", i, trace.labels[i]);
+		}
+		fprintf(stderr, "%s\n", trace.header->flags & TRACEFILE_STEPS ? ", with steps" : "");
+	}
+
+	printf("timestamp,x,y,z,vibrate,label\n");
+	uint64_t sample = seekTrace(&trace, from);
+	TraceBatch batch;
+	while (limit > 0 && traceBatch(&trace, sample, limit < TRACEFILE_BLOCK_SIZE ? (uint32_t) limit : TRACEFILE_BLOCK_SIZE, &batch)) {
+		for (uint32_t i = 0; i < batch.count; i++) {
+			const AccelData* s = &batch.samples[i];
+			printf("%llu,%d,%d,%d,%d,%u\n", (unsigned long long) s->timestamp, s->x, s->y, s->z, s->did_vibrate, batch.label);
+		}
+		sample += batch.count;
+		limit -= batch.count;
+	}
+	closeTraceFile(&trace);
+	return 0;
+}
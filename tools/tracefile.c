@@ -0,0 +1,229 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "tracefile.h"
+
+_Static_assert(sizeof(TraceHeader) == 64, "TraceHeader is 64 bytes on disk");
+_Static_assert(sizeof(TraceBlock) == 24, "TraceBlock is 24 bytes on disk");
+_Static_assert(sizeof(AccelData) == 16, "samples are stored in a 16 byte AccelData layout");
+
+
+static uint64_t align(uint64_t offset, uint64_t alignment) {
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+
+bool openTraceWriter(TraceWriter* writer, const char* path, uint32_t rate, const char* model, const char* const* labels, uint32_t labelCount) {
+	memset(writer, 0, sizeof(TraceWriter));
+	if (labelCount > TRACEFILE_MAX_LABELS)
+		return false;
+	writer->file = fopen(path, "wb");
+	if (writer->file == NULL) {
+		perror(path);
+		return false;
+	}
+
+	TraceHeader* header = &writer->header;
+	header->magic = TRACEFILE_MAGIC;
+	header->version = TRACEFILE_VERSION;
+	header->rate = (uint16_t) rate;
+	// NUL padded, a 16 character model fills it
+	size_t length = strlen(model);
+	memcpy(header->model, model, length < sizeof(header->model) ? length : sizeof(header->model));
+	header->flags = TRACEFILE_STEPS;
+	header->labelCount = labelCount;
+	header->samplesOffset = align(sizeof(TraceHeader) + labelCount * TRACEFILE_LABEL_SIZE, 16);
+
+	// Placeholder header, rewritten on close
+	fwrite(header, sizeof(TraceHeader), 1, writer->file);
+	for (uint32_t i = 0; i < labelCount; i++) {
+		char name[TRACEFILE_LABEL_SIZE] = { 0 };
+		strncpy(name, labels[i], sizeof(name) - 1);
+		fwrite(name, sizeof(name), 1, writer->file);
+	}
+	fseek(writer->file, (long) header->samplesOffset, SEEK_SET);
+	return true;
+}
+
+
+static TraceBlock* newBlock(TraceWriter* writer, const AccelData* sample, uint32_t label) {
+	if (writer->header.blockCount == writer->blockCapacity) {
+		writer->blockCapacity = writer->blockCapacity > 0 ? writer->blockCapacity * 2 : 1024;
+		writer->blocks = realloc(writer->blocks, writer->blockCapacity * sizeof(TraceBlock));
+	}
+	TraceBlock* block = &writer->blocks[writer->header.blockCount++];
+	memset(block, 0, sizeof(TraceBlock));
+	block->timestamp = sample->timestamp;
+	block->first = (uint32_t) writer->header.sampleCount;
+	block->label = (uint8_t) label;
+	return block;
+}
+
+
+bool writeTraceSamples(TraceWriter* writer, const AccelData* samples, uint32_t count, uint32_t label, uint32_t steps) {
+	if (count == 0)
+		return true;
+	if (writer->header.sampleCount + count > UINT32_MAX)
+		return false;
+
+	TraceBlock* block = writer->header.blockCount > 0 ? &writer->blocks[writer->header.blockCount - 1] : NULL;
+	for (uint32_t i = 0; i < count; i++) {
+		// Seeking needs samples in time order
+		if (writer->header.sampleCount > 0 && samples[i].timestamp < writer->lastTimestamp) {
+			fprintf(stderr, "sample %llu goes back in time\n", (unsigned long long) writer->header.sampleCount);
+			return false;
+		}
+		if (block == NULL || block->count == TRACEFILE_BLOCK_SIZE || block->label != label) {
+			block = newBlock(writer, &samples[i], label);
+			// Until this batch ends, the block carries the steps it started with
+			block->steps = writer->header.blockCount > 1 ? block[-1].steps : 0;
+		}
+		// Only the stored fields, the padding goes out as zeroes
+		AccelData sample;
+		memset(&sample, 0, sizeof(sample));
+		sample.x = samples[i].x;
+		sample.y = samples[i].y;
+		sample.z = samples[i].z;
+		sample.did_vibrate = samples[i].did_vibrate;
+		sample.timestamp = samples[i].timestamp;
+		fwrite(&sample, sizeof(sample), 1, writer->file);
+
+		block->count++;
+		writer->header.sampleCount++;
+		writer->lastTimestamp = samples[i].timestamp;
+	}
+
+	if (steps == TRACEFILE_NO_STEPS) {
+		writer->header.flags &= ~TRACEFILE_STEPS;
+	} else {
+		block->steps = steps;
+	}
+	return ! ferror(writer->file);
+}
+
+
+bool closeTraceWriter(TraceWriter* writer) {
+	TraceHeader* header = &writer->header;
+	header->indexOffset = header->samplesOffset + header->sampleCount * sizeof(AccelData);
+	fwrite(writer->blocks, sizeof(TraceBlock), header->blockCount, writer->file);
+	fseek(writer->file, 0, SEEK_SET);
+	fwrite(header, sizeof(TraceHeader), 1, writer->file);
+
+	bool ok = ! ferror(writer->file);
+	ok = fclose(writer->file) == 0 && ok;
+	free(writer->blocks);
+	writer->blocks = NULL;
+	writer->file = NULL;
+	return ok;
+}
+
+
+bool openTraceFile(TraceFile* trace, const char* path) {
+	memset(trace, 0, sizeof(TraceFile));
+	int file = open(path, O_RDONLY);
+	if (file < 0) {
+		perror(path);
+		return false;
+	}
+	struct stat status;
+	if (fstat(file, &status) < 0 || (size_t) status.st_size < sizeof(TraceHeader)) {
+		fprintf(stderr, "%s: not a trace\n", path);
+		close(file);
+		return false;
+	}
+	void* map = mmap(NULL, (size_t) status.st_size, PROT_READ, MAP_SHARED, file, 0);
+	close(file);
+	if (map == MAP_FAILED) {
+		perror(path);
+		return false;
+	}
+
+	trace->map = map;
+	trace->size = (size_t) status.st_size;
+	const TraceHeader* header = (const TraceHeader*) map;
+	if (header->magic != TRACEFILE_MAGIC || header->version != TRACEFILE_VERSION || header->labelCount > TRACEFILE_MAX_LABELS
+			|| header->samplesOffset % 16 != 0 || header->samplesOffset + header->sampleCount * sizeof(AccelData) > trace->size
+			|| header->indexOffset + (uint64_t) header->blockCount * sizeof(TraceBlock) > trace->size) {
+		fprintf(stderr, "%s: not a trace this reader knows\n", path);
+		closeTraceFile(trace);
+		return false;
+	}
+	trace->header = header;
+	trace->labels = (const char (*)[TRACEFILE_LABEL_SIZE]) (trace->map + sizeof(TraceHeader));
+	trace->samples = (const AccelData*) (trace->map + header->samplesOffset);
+	trace->blocks = (const TraceBlock*) (trace->map + header->indexOffset);
+	// Most tools read front to back
+	madvise(map, trace->size, MADV_SEQUENTIAL);
+	return true;
+}
+
+
+void closeTraceFile(TraceFile* trace) {
+	if (trace->map != NULL)
+		munmap((void*) trace->map, trace->size);
+	memset(trace, 0, sizeof(TraceFile));
+}
+
+
+// Last block whose first sample is at or before sample
+static uint32_t findBlock(const TraceFile* trace, uint64_t sample) {
+	uint32_t low = 0;
+	uint32_t high = trace->header->blockCount;
+	while (high - low > 1) {
+		uint32_t middle = low + (high - low) / 2;
+		if (trace->blocks[middle].first <= sample) {
+			low = middle;
+		} else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+
+uint64_t seekTrace(const TraceFile* trace, uint64_t timestamp) {
+	uint32_t blockCount = trace->header->blockCount;
+	// First block that starts after timestamp; the sample is in the one before it, or is that block's first
+	uint32_t low = 0;
+	uint32_t high = blockCount;
+	while (low < high) {
+		uint32_t middle = low + (high - low) / 2;
+		if (trace->blocks[middle].timestamp <= timestamp) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	if (low == 0)
+		return 0;
+
+	const TraceBlock* block = &trace->blocks[low - 1];
+	uint64_t first = block->first;
+	uint64_t last = first + block->count;
+	while (first < last) {
+		uint64_t middle = first + (last - first) / 2;
+		if (trace->samples[middle].timestamp < timestamp) {
+			first = middle + 1;
+		} else {
+			last = middle;
+		}
+	}
+	return first;
+}
+
+
+bool traceBatch(const TraceFile* trace, uint64_t sample, uint32_t size, TraceBatch* batch) {
+	if (sample >= trace->header->sampleCount)
+		return false;
+
+	uint32_t index = findBlock(trace, sample);
+	const TraceBlock* block = &trace->blocks[index];
+	uint64_t end = (uint64_t) block->first + block->count;
+	batch->samples = &trace->samples[sample];
+	batch->count = (uint32_t) (end - sample < size ? end - sample : size);
+	batch->label = block->label;
+	batch->steps = trace->header->flags & TRACEFILE_STEPS ? block->steps : TRACEFILE_NO_STEPS;
+	batch->block = index;
+	return true;
+}
@@ -0,0 +1,97 @@
+#ifndef _TRACEFILE_H_
+#define _TRACEFILE_H_
+
+#include <stdio.h>
+#include "pebble_worker.h"
+
+#define TRACEFILE_MAGIC			0x52543130	// "01TR"
+#define TRACEFILE_VERSION		1
+#define TRACEFILE_BLOCK_SIZE	256	// Most samples in one block
+#define TRACEFILE_LABEL_SIZE	16	// Bytes per label name, NUL padded
+#define TRACEFILE_MAX_LABELS	16
+#define TRACEFILE_NO_STEPS		UINT32_MAX
+
+// Flags
+#define TRACEFILE_STEPS			1	// Blocks carry the ground truth step count
+
+// Activity types as the worker numbers them
+#define TRACEFILE_ACTIVITY_LABELS	{ "sleep", "sit", "walk", "jog", "driving" }
+#define TRACEFILE_ACTIVITY_COUNT	5
+
+/*
+ * Binary accelerometer trace, little endian, as laid out on disk:
+ *   TraceHeader                    64 bytes
+ *   char labels[labelCount][16]    names of the label values, NUL padded
+ *   AccelData samples[sampleCount] at samplesOffset, 16 byte aligned
+ *   TraceBlock index[blockCount]   at indexOffset
+ * Samples are stored in the host's AccelData layout (int16 x, y, z, the vibrate flag, the uint64 timestamp in
+ * ms) so a mapped file hands the recognizer its batches without a copy. A block is a run of at most
+ * TRACEFILE_BLOCK_SIZE samples with one label; a new one starts whenever the label changes. Samples are in
+ * time order, which is what seeking relies on.
+ */
+typedef struct {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t rate;	// Samples per second
+	char model[16];	// Device the trace was recorded on, NUL padded
+	uint32_t flags;
+	uint32_t labelCount;
+	uint64_t sampleCount;
+	uint32_t blockCount;
+	uint32_t reserved;
+	uint64_t indexOffset;
+	uint64_t samplesOffset;
+} TraceHeader;
+
+typedef struct {
+	uint64_t timestamp;	// Of the first sample
+	uint32_t first;	// Index of the first sample
+	uint16_t count;
+	uint8_t label;
+	uint8_t reserved;
+	uint32_t steps;	// Ground truth steps since the start of the trace, at the end of the block
+	uint32_t reserved2;
+} TraceBlock;
+
+// Writing, streamed: samples go out as they come, the index and the final header on close
+typedef struct {
+	FILE* file;
+	TraceHeader header;
+	TraceBlock* blocks;
+	uint32_t blockCapacity;
+	uint64_t lastTimestamp;
+} TraceWriter;
+
+bool openTraceWriter(TraceWriter* writer, const char* path, uint32_t rate, const char* model, const char* const* labels, uint32_t labelCount);
+// steps is the running ground truth after these samples, TRACEFILE_NO_STEPS when there is none
+bool writeTraceSamples(TraceWriter* writer, const AccelData* samples, uint32_t count, uint32_t label, uint32_t steps);
+bool closeTraceWriter(TraceWriter* writer);
+
+// Reading, through a read-only mapping of the whole file
+typedef struct {
+	const uint8_t* map;
+	size_t size;
+	const TraceHeader* header;
+	const char (*labels)[TRACEFILE_LABEL_SIZE];
+	const AccelData* samples;
+	const TraceBlock* blocks;
+} TraceFile;
+
+// Samples straight out of the mapping, all from one block
+typedef struct {
+	const AccelData* samples;
+	uint32_t count;
+	uint32_t label;
+	uint32_t steps;	// Ground truth at the end of the block
+	uint32_t block;
+} TraceBatch;
+
+// False, with the reason on stderr, if the file is missing or not a trace this reader knows
+bool openTraceFile(TraceFile* trace, const char* path);
+void closeTraceFile(TraceFile* trace);
+// Index of the first sample at or after timestamp, sampleCount if there is none. O(log n).
+uint64_t seekTrace(const TraceFile* trace, uint64_t timestamp);
+// Up to size samples from sample on, cut at the end of its block. False past the end.
+bool traceBatch(const TraceFile* trace, uint64_t sample, uint32_t size, TraceBatch* batch);
+
+#endif